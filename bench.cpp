@@ -0,0 +1,122 @@
+#include <chrono>                       // std::chrono::steady_clock
+#include <cstdio>                       // std::printf()
+#include <string>                       // std::string
+#include <string_view>                  // std::string_view
+
+#include "xjson.hpp"
+
+/* 对比C接口与C++封装遍历同一json的耗时，两者结果须完全相同 */
+
+static std::string
+make_json(std::size_t rows) {
+        std::string json = "[";
+
+        for (std::size_t i = 0; i < rows; i++) {
+                if (i > 0) json += ',';
+                json += "[" + std::to_string(i) + ", " + std::to_string(i * 0.5) + ", \"row-" +
+                        std::to_string(i) + "\", " + (i % 2 ? "true" : "false") + ", [1, 2, 3]]";
+        }
+        json += "]";
+
+        return json;
+}
+
+struct totals {
+        double sum = 0;
+        std::size_t bytes = 0, flags = 0;
+};
+
+static void
+walk_c(const xjson_value *v, totals &t) {
+        switch (xjson_get_type(v)) {
+                case XJSON_NUMBER:
+                        t.sum += xjson_get_number(v);
+                        break;
+                case XJSON_STRING:
+                        t.bytes += xjson_get_string_length(v);
+                        break;
+                case XJSON_TRUE:
+                case XJSON_FALSE:
+                        t.flags += xjson_get_boolean(v);
+                        break;
+                case XJSON_ARRAY:
+                        for (std::size_t i = 0, n = xjson_get_array_size(v); i < n; i++) {
+                                walk_c(xjson_get_array_element(v, i), t);
+                        }
+                        break;
+                default:
+                        break;
+        }
+}
+
+static void
+walk_cpp(xjson::value_ref v, totals &t) {
+        switch (v.type()) {
+                case XJSON_NUMBER:
+                        t.sum += v.get<double>();
+                        break;
+                case XJSON_STRING:
+                        t.bytes += v.get<std::string_view>().size();
+                        break;
+                case XJSON_TRUE:
+                case XJSON_FALSE:
+                        t.flags += v.get<bool>();
+                        break;
+                case XJSON_ARRAY:
+                        for (xjson::value_ref e : v) {
+                                walk_cpp(e, t);
+                        }
+                        break;
+                default:
+                        break;
+        }
+}
+
+template <class F>
+static double
+measure(int rounds, F f) {
+        f();                            // 预热，排除首次分配的影响
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+                f();
+        }
+        std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - begin;
+
+        return ms.count() / rounds;
+}
+
+int
+main(int argc, char *argv[]) {
+        std::size_t rows = argc > 1 ? std::stoul(argv[1]) : 100000;
+        int rounds = argc > 2 ? std::stoi(argv[2]) : 20;
+        std::string json = make_json(rows);
+        xjson::parser p;
+        xjson::document doc;
+        totals c, cpp;
+
+        if (doc.parse(p, json) != XJSON_PARSE_OK) {
+                std::printf("parse failed\n");
+                return 1;
+        }
+
+        double parse_c = measure(rounds, [&] {
+                xjson_value v;
+                xjson_parser_parse(p.c_ptr(), &v, json.data(), json.size());
+                xjson_free(&v);
+        });
+        double parse_cpp = measure(rounds, [&] { doc.parse(p, json); });
+        double walk_c_ms = measure(rounds, [&] { c = totals(); walk_c(doc.c_ptr(), c); });
+        double walk_cpp_ms = measure(rounds, [&] { cpp = totals(); walk_cpp(doc.root(), cpp); });
+
+        std::printf("kernel: %s, %zu bytes, %d rounds\n",
+                xjson_get_kernel_name(xjson_get_kernel()), json.size(), rounds);
+        std::printf("parse  C %8.3f ms  C++ %8.3f ms\n", parse_c, parse_cpp);
+        std::printf("walk   C %8.3f ms  C++ %8.3f ms\n", walk_c_ms, walk_cpp_ms);
+
+        if (c.sum != cpp.sum || c.bytes != cpp.bytes || c.flags != cpp.flags) {
+                std::printf("results differ\n");
+                return 1;
+        }
+
+        return 0;
+}
@@ -1,8 +1,13 @@
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "xjson.h"
 
+#ifdef XJSON_ENABLE_THREADS
+#include <pthread.h>
+#endif
+
 static int test_ret = 0;
 static int test_count = 0;
 static int test_pass = 0;
@@ -75,6 +80,7 @@ static void test_parse_false() {
                 EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, json));\
                 EXPECT_EQ_INT(XJSON_NUMBER, xjson_get_type(&v));\
                 EXPECT_EQ_DOUBLE(expect, xjson_get_number(&v));\
+                EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_validate(json, strlen(json), NULL));\
                 xjson_free(&v);\
         } while(0)
 
@@ -133,6 +139,7 @@ static void test_parse_number() {
                 EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, json));\
                 EXPECT_EQ_INT(XJSON_STRING, xjson_get_type(&v));\
                 EXPECT_EQ_STRING(expect, xjson_get_string(&v), xjson_get_string_length(&v));\
+                EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_validate(json, strlen(json), NULL));\
                 xjson_free(&v);\
         } while(0)
 
@@ -141,6 +148,17 @@ static void test_parse_string() {
         TEST_STRING("Hello", "\"Hello\"");
         TEST_STRING("Hello\nWorld", "\"Hello\\nWorld\"");
         TEST_STRING("\" \\ / \b \f \n \r \t", "\"\\\" \\\\ \\/ \\b \\f \\n \\r \\t\"");
+        TEST_STRING("Hello\0World", "\"Hello\\u0000World\"");
+        TEST_STRING("\x24", "\"\\u0024\"");                       /* Dollar sign U+0024 */
+        TEST_STRING("\xC2\xA2", "\"\\u00A2\"");                   /* Cents sign U+00A2 */
+        TEST_STRING("\xE2\x82\xAC", "\"\\u20AC\"");               /* Euro sign U+20AC */
+        TEST_STRING("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");   /* G clef sign U+1D11E */
+        TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");   /* G clef sign U+1D11E */
+
+        /* 原样保留的UTF-8字符，包括跨越16字节边界的多字节字符 */
+        TEST_STRING("\xE4\xBD\xA0\xE5\xA5\xBD", "\"\xE4\xBD\xA0\xE5\xA5\xBD\"");
+        TEST_STRING("0123456789abcd\xF0\x9D\x84\x9E" "0123456789abcdef\xE2\x82\xAC",
+                "\"0123456789abcd\xF0\x9D\x84\x9E" "0123456789abcdef\xE2\x82\xAC\"");
 }
 
 static void test_parse_array() {
@@ -161,6 +179,7 @@ static void test_parse_array() {
                 v.type = XJSON_FALSE;\
                 EXPECT_EQ_INT(error, xjson_parse(&v, json));\
                 EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&v));\
+                EXPECT_EQ_INT(error, xjson_validate(json, strlen(json), NULL));\
                 xjson_free(&v);\
         } while(0)
 
@@ -215,6 +234,44 @@ static void test_parse_invalid_string_escape() {
         TEST_ERROR(XJSON_PARSE_INVALID_STRING_ESCAPE, "\"\\x12\"");
 }
 
+static void test_parse_invalid_unicode_hex() {
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u0\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u01\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u012\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u/000\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\uG000\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u0/00\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u00G0\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u000/\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u 123\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_HEX, "\"\\uD800\\u12\"");
+}
+
+static void test_parse_invalid_unicode_surrogate() {
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDBFF\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDC00\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\\\\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uDBFF\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uE000\"");
+}
+
+static void test_parse_invalid_utf8() {
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"\x80\"");                      /* 孤立的后续字节 */
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"\xC0\xAF\"");                  /* 过长编码 */
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"\xE0\x80\xAF\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"\xF0\x80\x80\xAF\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"\xED\xA0\x80\"");              /* 代理项 */
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"\xF4\x90\x80\x80\"");          /* 超过U+10FFFF */
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"\xF8\x88\x80\x80\x80\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"\xE2\x82\"");                  /* 不完整 */
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"\xE2\x82\\n\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"0123456789abcde\xE2\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "\"0123456789abcdef\xE2\x82\xAC\xE2\x82\"");
+        TEST_ERROR(XJSON_PARSE_INVALID_UTF8, "[\"\xC3\xA9\", \"\xC3\"]");
+}
+
 static void test_parse_invalid_string_char() {
         TEST_ERROR(XJSON_PARSE_INVALID_STRING_CHAR, "\"\x01\"");
         TEST_ERROR(XJSON_PARSE_INVALID_STRING_CHAR, "\"\x1F\"");
@@ -227,6 +284,811 @@ static void test_parse_miss_comma_or_square_bracket() {
         TEST_ERROR(XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[[]");
 }
 
+#define TEST_VALIDATE(error, _offset, json, len)\
+        do {\
+                size_t offset;\
+                EXPECT_EQ_INT(error, xjson_validate(json, len, &offset));\
+                EXPECT_EQ_SIZE_T(_offset, offset);\
+        } while(0)
+
+static void test_validate() {
+        TEST_VALIDATE(XJSON_PARSE_OK, 4, "null", 4);
+        TEST_VALIDATE(XJSON_PARSE_OK, 11, " [1, [\"a\"]] ", 11);
+        TEST_VALIDATE(XJSON_PARSE_OK, 33, "[\"a long string without escapes\"]", 33);
+
+        /* json无需以'\0'结尾 */
+        TEST_VALIDATE(XJSON_PARSE_OK, 5, "[1,2]xyz", 5);
+        TEST_VALIDATE(XJSON_PARSE_OK, 3, "123456", 3);
+        TEST_VALIDATE(XJSON_PARSE_INVALID_VALUE, 1, "true", 3);
+        TEST_VALIDATE(XJSON_PARSE_MISS_QUOTATION_MARK, 4, "\"abc\"", 4);
+        TEST_VALIDATE(XJSON_PARSE_EXPECT_VALUE, 3, "[1,2]", 3);
+
+        /* 出错位置 */
+        TEST_VALIDATE(XJSON_PARSE_INVALID_STRING_ESCAPE, 5, "[\"abc\\v\"]", 10);
+        TEST_VALIDATE(XJSON_PARSE_INVALID_STRING_CHAR, 17, "\"0123456789abcdef\x01\"", 19);
+        TEST_VALIDATE(XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, 3, "[1 2]", 5);
+        TEST_VALIDATE(XJSON_PARSE_ROOT_NOT_SINGULAR, 5, "null x", 6);
+
+        /* 溢出判定与strtod一致 */
+        TEST_VALIDATE(XJSON_PARSE_OK, 23, "1.7976931348623158e+308", 23);
+        TEST_VALIDATE(XJSON_PARSE_NUMBER_TOO_BIG, 0, "1.7976931348623159e+308", 23);
+        TEST_VALIDATE(XJSON_PARSE_NUMBER_TOO_BIG, 0, "0.018e310", 9);
+        TEST_VALIDATE(XJSON_PARSE_OK, 9, "0.017e310", 9);
+        TEST_VALIDATE(XJSON_PARSE_OK, 10, "0.000e9999", 10);
+}
+
+static void test_parser() {
+        xjson_parser p;
+        xjson_value v;
+        xjson_parser_init(&p);
+        xjson_init(&v);
+
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parser_parse(&p, &v, "[1, \"a\\n\", [null, true]]", 24));
+        EXPECT_EQ_SIZE_T(3, xjson_get_array_size(&v));
+        xjson_free(&v);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parser_parse(&p, &v, "[\"abc\"]xyz", 7));
+        EXPECT_EQ_SIZE_T(1, xjson_get_array_size(&v));
+        xjson_free(&v);
+        EXPECT_EQ_INT(XJSON_PARSE_ROOT_NOT_SINGULAR, xjson_parser_parse(&p, &v, "[1] x", 5));
+        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&v));
+
+#ifdef XJSON_ENABLE_STATS
+        const xjson_stats *stats = xjson_parser_get_stats(&p);
+        EXPECT_EQ_SIZE_T(3, stats->documents);
+        EXPECT_EQ_SIZE_T(1, stats->errors);
+        EXPECT_EQ_SIZE_T(24 + 7 + 4, stats->bytes);
+        EXPECT_EQ_SIZE_T(1, stats->values[XJSON_NULL]);
+        EXPECT_EQ_SIZE_T(1, stats->values[XJSON_TRUE]);
+        EXPECT_EQ_SIZE_T(2, stats->values[XJSON_NUMBER]);
+        EXPECT_EQ_SIZE_T(2, stats->values[XJSON_STRING]);
+        EXPECT_EQ_SIZE_T(4, stats->values[XJSON_ARRAY]);
+        EXPECT_EQ_SIZE_T(4, stats->string_bytes_copied);
+        EXPECT_EQ_SIZE_T(1, stats->string_bytes_escaped);
+        EXPECT_EQ_SIZE_T(2, stats->depth_max);
+        EXPECT_EQ_SIZE_T(6, stats->allocs);
+        EXPECT_EQ_SIZE_T(1, stats->stack_reallocs);
+        EXPECT_EQ_INT(xjson_get_kernel(), stats->kernel);
+        EXPECT_TRUE(stats->stack_peak >= 2 * sizeof(xjson_value));
+        xjson_parser_reset_stats(&p);
+        EXPECT_EQ_SIZE_T(0, stats->documents);
+#endif
+
+        xjson_parser_free(&p);
+}
+
+static void test_kernel_once(size_t n) {
+        char json[512], expect[512];
+        size_t len = 0, i;
+        xjson_value v;
+
+        /* n个ASCII字符后跟转义与非ASCII字符，使其落在向量块内的不同位置 */
+        json[len++] = '\"';
+        for (i = 0; i < n; i++) {
+                json[len++] = expect[i] = 'a' + i % 26;
+        }
+        memcpy(json + len, "\\n\xC3\xA9" "b\"", 6);
+        memcpy(expect + n, "\n\xC3\xA9" "b", 4);
+        len += 6;
+        json[len] = '\0';
+
+        xjson_init(&v);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, json));
+        EXPECT_EQ_SIZE_T(n + 4, xjson_get_string_length(&v));
+        EXPECT_TRUE(memcmp(expect, xjson_get_string(&v), n + 4) == 0);
+        xjson_free(&v);
+
+        json[n + 4] = '\xC3';
+        json[n + 5] = '(';
+        EXPECT_EQ_INT(XJSON_PARSE_INVALID_UTF8, xjson_parse(&v, json));
+        json[n + 1] = '\x1f';
+        EXPECT_EQ_INT(XJSON_PARSE_INVALID_STRING_CHAR, xjson_parse(&v, json));
+
+        /* n个空白后跟array */
+        for (i = 0; i < n; i++) {
+                json[i] = " \n\t\r"[i % 4];
+        }
+        memcpy(json + n, "[1,", 3);
+        memcpy(json + n + 3, json, n);
+        memcpy(json + 2 * n + 3, "2]", 3);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, json));
+        EXPECT_EQ_SIZE_T(2, xjson_get_array_size(&v));
+        xjson_free(&v);
+}
+
+static void test_kernel() {
+        xjson_kernel saved = xjson_get_kernel();
+
+        EXPECT_TRUE(xjson_set_kernel(XJSON_KERNEL_SCALAR));
+        EXPECT_EQ_INT(XJSON_KERNEL_SCALAR, xjson_get_kernel());
+        EXPECT_FALSE(xjson_set_kernel(XJSON_KERNEL_COUNT));
+        EXPECT_EQ_INT(XJSON_KERNEL_SCALAR, xjson_get_kernel());
+        EXPECT_TRUE(strcmp("avx2", xjson_get_kernel_name(XJSON_KERNEL_AVX2)) == 0);
+
+        for (int k = XJSON_KERNEL_SCALAR; k < XJSON_KERNEL_COUNT; k++) {
+                if (!xjson_set_kernel(k)) {
+                        continue;
+                }
+                EXPECT_EQ_INT(k, xjson_get_kernel());
+                for (size_t n = 0; n < 140; n++) {
+                        test_kernel_once(n);
+                }
+        }
+
+        EXPECT_TRUE(xjson_set_kernel(XJSON_KERNEL_AUTO));
+        EXPECT_TRUE(xjson_set_kernel(saved));
+}
+
+static int check_spans(const char *text, size_t begin, const xjson_value *v, const xjson_span *s) {
+        const char *all[] = { "" };
+        xjson_value sub;
+        int ok;
+
+        begin += s->offset;
+        xjson_init(&sub);
+        ok = xjson_parse_projected(&sub, text + begin, s->length, all, 1) == XJSON_PARSE_OK && xjson_equal(&sub, v);
+        xjson_free(&sub);
+        if (xjson_get_type(v) == XJSON_ARRAY) {
+                ok = ok && s->count == xjson_get_array_size(v);
+                for (size_t i = 0; ok && i < s->count; i++) {
+                        ok = check_spans(text, begin, xjson_get_array_element(v, i), &s->children[i]);
+                }
+        }
+
+        return ok;
+}
+
+#define TEST_REPARSE(expect, d, offset, removed, inserted)\
+        do {\
+                xjson_value full;\
+                xjson_init(&full);\
+                EXPECT_EQ_INT(expect, xjson_reparse(d, offset, removed, inserted, strlen(inserted)));\
+                EXPECT_EQ_INT(expect, xjson_parse(&full, (d)->text));\
+                EXPECT_TRUE(xjson_equal(&full, &(d)->root));\
+                if (expect == XJSON_PARSE_OK) {\
+                        EXPECT_TRUE(check_spans((d)->text, 0, &(d)->root, &(d)->span));\
+                }\
+                xjson_free(&full);\
+        } while(0)
+
+static void test_reparse() {
+        const char *json = " [1, [2, 3], [\"a\", [4]], 5] ";
+        xjson_document d;
+        xjson_value *untouched;
+
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_document_init(&d, json, strlen(json)));
+        EXPECT_EQ_SIZE_T(1, d.span.offset);
+        EXPECT_TRUE(check_spans(d.text, 0, &d.root, &d.span));
+
+        /* 只重新解析[2, 3]，其余array的成员不变 */
+        untouched = xjson_get_array_element(&d.root, 2)->u.a.e;
+        TEST_REPARSE(XJSON_PARSE_OK, &d, 9, 1, "30, 31");
+        EXPECT_TRUE(xjson_get_array_element(&d.root, 2)->u.a.e == untouched);
+        EXPECT_EQ_SIZE_T(3, xjson_get_array_size(xjson_get_array_element(&d.root, 1)));
+
+        /* 删除[4]中的成员，之后的位置随之平移 */
+        untouched = xjson_get_array_element(&d.root, 1)->u.a.e;
+        TEST_REPARSE(XJSON_PARSE_OK, &d, 25, 1, "");
+        EXPECT_TRUE(xjson_get_array_element(&d.root, 1)->u.a.e == untouched);
+        TEST_REPARSE(XJSON_PARSE_OK, &d, 25, 0, "\"b\", [], null");
+
+        /* 插入新成员，重新解析根array */
+        TEST_REPARSE(XJSON_PARSE_OK, &d, 2, 0, "[true], ");
+        EXPECT_EQ_SIZE_T(5, xjson_get_array_size(&d.root));
+
+        /* 编辑破坏了括号配对，退回整体解析并失败，修复后恢复 */
+        TEST_REPARSE(XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, &d, 7, 1, "");
+        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&d.root));
+        TEST_REPARSE(XJSON_PARSE_OK, &d, 7, 0, "]");
+
+        /* 编辑根array的括号或之外的部分 */
+        TEST_REPARSE(XJSON_PARSE_ROOT_NOT_SINGULAR, &d, d.length, 0, "0");
+        TEST_REPARSE(XJSON_PARSE_OK, &d, d.length - 1, 1, "");
+        TEST_REPARSE(XJSON_PARSE_OK, &d, 0, d.length, "\"x\"");
+        EXPECT_EQ_INT(XJSON_STRING, xjson_get_type(&d.root));
+        TEST_REPARSE(XJSON_PARSE_OK, &d, 0, d.length, "[[[1]]]");
+        TEST_REPARSE(XJSON_PARSE_OK, &d, 3, 1, "[]");
+        xjson_document_free(&d);
+}
+
+static void test_parse_batch() {
+        const char *docs[] = {
+                "[1, \"abc\", [true]]", "null", "[1,]", "\"\\u20AC\"", "[[], [[]]]xyz", "-1.5"
+        };
+        size_t lens[] = { 18, 4, 4, 8, 10, 4 };
+        xjson_value out[6], e;
+        int status[6];
+        xjson_parser p;
+        static char big[XJSON_ARENA_CHUNK_SIZE + 16];
+
+        xjson_parser_init(&p);
+        xjson_init(&e);
+
+        for (unsigned threads = 1; threads <= 4; threads++) {
+                p.threads = threads;
+                EXPECT_EQ_SIZE_T(5, xjson_parse_batch(&p, docs, lens, 6, out, status));
+                EXPECT_EQ_INT(XJSON_PARSE_INVALID_VALUE, status[2]);
+                EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&out[2]));
+                for (int i = 0; i < 6; i++) {
+                        if (i == 2) {
+                                continue;
+                        }
+                        EXPECT_EQ_INT(XJSON_PARSE_OK, status[i]);
+                        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parser_parse(&p, &e, docs[i], lens[i]));
+                        EXPECT_TRUE(xjson_equal(&e, &out[i]));
+                        xjson_free(&e);
+                }
+                xjson_parser_free_batch(&p);
+        }
+
+        /* 超过一块的字符串，结果区复用 */
+        memset(big, 'a', sizeof(big));
+        big[0] = big[sizeof(big) - 1] = '\"';
+        docs[0] = big;
+        lens[0] = sizeof(big);
+        for (int round = 0; round < 2; round++) {
+                EXPECT_EQ_SIZE_T(1, xjson_parse_batch(&p, docs, lens, 1, out, NULL));
+                EXPECT_EQ_SIZE_T(sizeof(big) - 2, xjson_get_string_length(&out[0]));
+        }
+        EXPECT_EQ_SIZE_T(0, xjson_parse_batch(&p, NULL, NULL, 0, NULL, NULL));
+
+        xjson_parser_free(&p);
+}
+
+static void test_parse_lazy_number() {
+        xjson_parser p;
+        xjson_value v, e;
+        const char *json = "[1.5, -0, 123456789012345678901234567890, 1e-400]";
+        const char *literal;
+        size_t length;
+
+        xjson_parser_init(&p);
+        p.flags = XJSON_PARSER_LAZY_NUMBERS;
+        xjson_init(&v);
+        xjson_init(&e);
+
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parser_parse(&p, &v, json, strlen(json)));
+        literal = xjson_get_number_literal(xjson_get_array_element(&v, 2), &length);
+        EXPECT_EQ_STRING("123456789012345678901234567890", literal, length);
+        EXPECT_EQ_DOUBLE(1.5, xjson_get_number(xjson_get_array_element(&v, 0)));
+        EXPECT_EQ_DOUBLE(-0.0, xjson_get_number(xjson_get_array_element(&v, 1)));
+        EXPECT_EQ_DOUBLE(1.2345678901234568e+29, xjson_get_number(xjson_get_array_element(&v, 2)));
+        EXPECT_EQ_DOUBLE(0.0, xjson_get_number(xjson_get_array_element(&v, 3)));
+
+        /* 转换结果与立即转换一致 */
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&e, json));
+        EXPECT_TRUE(xjson_equal(&e, &v));
+        EXPECT_TRUE(xjson_get_number_literal(xjson_get_array_element(&e, 0), NULL) == NULL);
+
+        xjson_set_number(xjson_get_array_element(&v, 2), 2.0);
+        EXPECT_TRUE(xjson_get_number_literal(xjson_get_array_element(&v, 2), NULL) == NULL);
+        EXPECT_EQ_DOUBLE(2.0, xjson_get_number(xjson_get_array_element(&v, 2)));
+        xjson_free(&v);
+        xjson_free(&e);
+
+        /* 原文位于输入末尾，且json无需以'\0'结尾 */
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parser_parse(&p, &v, "1234567", 3));
+        EXPECT_EQ_DOUBLE(123.0, xjson_get_number(&v));
+        json = "[0.0000000000000000000000000000000000000000000000000000000000000000000000001e73]";
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parser_parse(&p, &v, json, strlen(json)));
+        EXPECT_EQ_DOUBLE(1.0, xjson_get_number(xjson_get_array_element(&v, 0)));
+        xjson_free(&v);
+
+        /* 错误与立即转换一致 */
+        EXPECT_EQ_INT(XJSON_PARSE_NUMBER_TOO_BIG, xjson_parser_parse(&p, &v, "[1e309]", 7));
+        EXPECT_EQ_INT(XJSON_PARSE_INVALID_VALUE, xjson_parser_parse(&p, &v, "[1.]", 4));
+
+        xjson_parser_free(&p);
+}
+
+typedef struct {
+        short x;
+        double y;
+}test_point;
+
+typedef struct {
+        int id;
+        char active;
+        float ratio;
+        char name[8];
+        test_point pos;
+        long long big;
+}test_record;
+
+static const xjson_field_desc test_point_desc[] = {
+        XJSON_FIELD(test_point, x, XJSON_FIELD_INT),
+        XJSON_FIELD(test_point, y, XJSON_FIELD_DOUBLE),
+        XJSON_FIELD_LAST
+};
+
+static const xjson_field_desc test_record_desc[] = {
+        XJSON_FIELD(test_record, id, XJSON_FIELD_INT),
+        XJSON_FIELD(test_record, active, XJSON_FIELD_BOOLEAN),
+        XJSON_FIELD(test_record, ratio, XJSON_FIELD_DOUBLE),
+        XJSON_FIELD(test_record, name, XJSON_FIELD_STRING),
+        XJSON_FIELD_NESTED(test_record, pos, test_point_desc),
+        XJSON_FIELD(test_record, big, XJSON_FIELD_INT),
+        XJSON_FIELD_LAST
+};
+
+#define TEST_DECODE_ERROR(error, json)\
+        do {\
+                test_record r;\
+                EXPECT_EQ_INT(error, xjson_decode_struct(json, strlen(json), test_record_desc, &r));\
+        } while(0)
+
+static void test_struct() {
+        test_record r, s;
+        char buf[128];
+        size_t len;
+        const char *json = " [ 42, true, 0.5, \"a\\tb\\u00e9\", [-7, 1.25], -9223372036854775808 ] ";
+
+        memset(&r, 0xff, sizeof(r));
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_decode_struct(json, strlen(json), test_record_desc, &r));
+        EXPECT_EQ_INT(42, r.id);
+        EXPECT_EQ_INT(1, r.active);
+        EXPECT_EQ_DOUBLE(0.5, r.ratio);
+        EXPECT_EQ_STRING("a\tb\xC3\xA9", r.name, strlen(r.name));
+        EXPECT_EQ_INT(-7, r.pos.x);
+        EXPECT_EQ_DOUBLE(1.25, r.pos.y);
+        EXPECT_TRUE(r.big == -9223372036854775807LL - 1);
+
+        /* 编码后再解码 */
+        len = xjson_encode_struct(&r, test_record_desc, buf, sizeof(buf));
+        EXPECT_EQ_STRING("[42,true,0.5,\"a\\tb\xC3\xA9\",[-7,1.25],-9223372036854775808]", buf, len);
+        memset(&s, 0, sizeof(s));
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_decode_struct(buf, len, test_record_desc, &s));
+        EXPECT_EQ_INT(r.id, s.id);
+        EXPECT_EQ_STRING("a\tb\xC3\xA9", s.name, strlen(s.name));
+        EXPECT_EQ_DOUBLE(r.pos.y, s.pos.y);
+
+        /* 空间不足时截断，返回完整长度 */
+        EXPECT_EQ_SIZE_T(len, xjson_encode_struct(&r, test_record_desc, buf, 5));
+        EXPECT_EQ_STRING("[42,", buf, strlen(buf));
+        EXPECT_EQ_SIZE_T(len, xjson_encode_struct(&r, test_record_desc, NULL, 0));
+
+        /* null将字段清零 */
+        json = "[null, false, null, null, null, 0]";
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_decode_struct(json, strlen(json), test_record_desc, &r));
+        EXPECT_EQ_INT(0, r.id);
+        EXPECT_EQ_INT(0, r.active);
+        EXPECT_EQ_SIZE_T(0, strlen(r.name));
+        EXPECT_EQ_INT(0, r.pos.x);
+        EXPECT_EQ_DOUBLE(0.0, r.pos.y);
+
+        /* json无需以'\0'结尾 */
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_decode_struct("[1,2]xyz", 5, test_point_desc, &r.pos));
+        EXPECT_EQ_INT(1, r.pos.x);
+        EXPECT_EQ_DOUBLE(2.0, r.pos.y);
+
+        TEST_DECODE_ERROR(XJSON_PARSE_EXPECT_VALUE, "");
+        TEST_DECODE_ERROR(XJSON_PARSE_INVALID_VALUE, "[?, true, 0, \"\", [0, 0], 0]");
+        TEST_DECODE_ERROR(XJSON_PARSE_ROOT_NOT_SINGULAR, "[1, true, 0, \"\", [0, 0], 0] 1");
+        TEST_DECODE_ERROR(XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1 true, 0, \"\", [0, 0], 0]");
+        TEST_DECODE_ERROR(XJSON_PARSE_INVALID_STRING_ESCAPE, "[1, true, 0, \"\\v\", [0, 0], 0]");
+        TEST_DECODE_ERROR(XJSON_DECODE_TYPE_MISMATCH, "{}");
+        TEST_DECODE_ERROR(XJSON_DECODE_TYPE_MISMATCH, "[1.5, true, 0, \"\", [0, 0], 0]");
+        TEST_DECODE_ERROR(XJSON_DECODE_TYPE_MISMATCH, "[1, 1, 0, \"\", [0, 0], 0]");
+        TEST_DECODE_ERROR(XJSON_DECODE_TYPE_MISMATCH, "[1, true, 0, \"\", 0, 0]");
+        TEST_DECODE_ERROR(XJSON_DECODE_COUNT_MISMATCH, "[]");
+        TEST_DECODE_ERROR(XJSON_DECODE_COUNT_MISMATCH, "[1, true, 0, \"\", [0], 0]");
+        TEST_DECODE_ERROR(XJSON_DECODE_COUNT_MISMATCH, "[1, true, 0, \"\", [0, 0], 0, 0]");
+        TEST_DECODE_ERROR(XJSON_DECODE_OUT_OF_RANGE, "[2147483648, true, 0, \"\", [0, 0], 0]");
+        TEST_DECODE_ERROR(XJSON_DECODE_OUT_OF_RANGE, "[1, true, 0, \"\", [32768, 0], 0]");
+        TEST_DECODE_ERROR(XJSON_DECODE_OUT_OF_RANGE, "[1, true, 0, \"\", [0, 0], 9223372036854775808]");
+        TEST_DECODE_ERROR(XJSON_DECODE_OUT_OF_RANGE, "[1, true, 0, \"01234567\", [0, 0], 0]");
+        TEST_DECODE_ERROR(XJSON_PARSE_OK, "[-2147483648, true, 0, \"0123456\", [-32768, 0], 0]");
+}
+
+#define TEST_PROJECTED(error, expect, json, ...)\
+        do {\
+                const char *paths[] = { __VA_ARGS__ };\
+                xjson_value v, e;\
+                xjson_init(&e);\
+                EXPECT_EQ_INT(error, xjson_parse_projected(&v, json, strlen(json), paths,\
+                        sizeof(paths) / sizeof(paths[0])));\
+                if (error == XJSON_PARSE_OK) {\
+                        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&e, expect));\
+                }\
+                EXPECT_TRUE(xjson_equal(&e, &v));\
+                xjson_free(&v);\
+                xjson_free(&e);\
+        } while(0)
+
+static void test_parse_projected() {
+        const char *json = "[[1, \"a\\u0041\", [2, 3]], [4, \"b\", [5, 6]], 7]";
+        const char *path = "/0/1";
+        xjson_value v;
+
+        TEST_PROJECTED(XJSON_PARSE_OK, "[[1, null, null], null, null]", json, "/0/0");
+        TEST_PROJECTED(XJSON_PARSE_OK, "[[null, null, [null, 3]], [null, null, [null, 6]], null]", json, "/*/2/1");
+        TEST_PROJECTED(XJSON_PARSE_OK, "[[1, null, [null, 3]], [null, \"b\", [null, 6]], null]",
+                json, "/*/2/1", "/0/0", "/1/1");
+        TEST_PROJECTED(XJSON_PARSE_OK, "[[1, \"aA\", [2, 3]], null, 7]", json, "/0", "/2");
+        TEST_PROJECTED(XJSON_PARSE_OK, "[[1, \"aA\", [2, 3]], [4, \"b\", [5, 6]], 7]", json, "", "/0/0");
+        TEST_PROJECTED(XJSON_PARSE_OK, "[null, null, null]", json, "/3", "/2/0", "/10/0");
+        TEST_PROJECTED(XJSON_PARSE_OK, "[]", " [ ] ", "/0");
+        TEST_PROJECTED(XJSON_PARSE_OK, "1", "1", "");
+
+        /* 未选中的部分不解析 */
+        TEST_PROJECTED(XJSON_PARSE_OK, "[null, 1]", "[\"\\v\", 1]", "/1");
+        TEST_PROJECTED(XJSON_PARSE_OK, "[null, 1]", "[[nul, 1e999, \"]\\\"\"], 1]", "/1");
+
+        TEST_PROJECTED(XJSON_PARSE_EXPECT_VALUE, NULL, "", "/0");
+        TEST_PROJECTED(XJSON_PARSE_INVALID_VALUE, NULL, "[1,]", "/0");
+        TEST_PROJECTED(XJSON_PARSE_INVALID_VALUE, NULL, "[1, nul]", "/1");
+        TEST_PROJECTED(XJSON_PARSE_ROOT_NOT_SINGULAR, NULL, "[1] x", "/0");
+        TEST_PROJECTED(XJSON_PARSE_MISS_QUOTATION_MARK, NULL, "[1, [\"abc]]", "/0");
+        TEST_PROJECTED(XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, NULL, "[1, [2", "/0");
+        TEST_PROJECTED(XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, NULL, "[1, 2 3]", "/0");
+
+        /* 没有投影路径时只检查结构 */
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse_projected(&v, json, strlen(json), NULL, 0));
+        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&v));
+
+        /* json无需以'\0'结尾 */
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse_projected(&v, "[[1,2]]]", 7, &path, 1));
+        EXPECT_EQ_DOUBLE(2.0, xjson_get_number(xjson_get_array_element(xjson_get_array_element(&v, 0), 1)));
+        xjson_free(&v);
+}
+
+#define TEST_PARSE_STATIC(json)\
+        do {\
+                xjson_value v, e;\
+                size_t size, cap;\
+                char *buf;\
+                xjson_init(&e);\
+                EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_required_size(json, strlen(json), &size));\
+                buf = (char *)malloc(size > 0 ? size : 1);\
+                EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse_static(&v, json, strlen(json), buf, size));\
+                EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&e, json));\
+                EXPECT_TRUE(xjson_equal(&e, &v));\
+                for (cap = 0; cap < size; cap++) {\
+                        EXPECT_EQ_INT(XJSON_PARSE_OUT_OF_MEMORY, xjson_parse_static(&v, json, strlen(json), buf, cap));\
+                        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&v));\
+                }\
+                xjson_free(&e);\
+                free(buf);\
+        } while(0)
+
+static void test_parse_static() {
+        xjson_value v;
+        size_t size = 1;
+        double buf[8];
+
+        TEST_PARSE_STATIC("null");
+        TEST_PARSE_STATIC("[]");
+        TEST_PARSE_STATIC("123");
+        TEST_PARSE_STATIC("\"\"");
+        TEST_PARSE_STATIC("\"Hello\\nWorld\\u20AC\\uD834\\uDD1E\"");
+        TEST_PARSE_STATIC("[1, \"abc\", [true, [false, null]], [[], \"\"]]");
+        TEST_PARSE_STATIC("[[[[\"0123456789abcdef0123456789abcdef\"]]], 1.5e3, [\"x\", \"y\", \"z\"]]");
+
+        /* json无需以'\0'结尾 */
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_required_size("1234", 2, &size));
+        EXPECT_TRUE(size > 0);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse_static(&v, "1234", 2, buf, size));
+        EXPECT_EQ_DOUBLE(12.0, xjson_get_number(&v));
+
+        /* 错误与xjson_parse一致 */
+        EXPECT_EQ_INT(XJSON_PARSE_INVALID_VALUE, xjson_required_size("[1,]", 4, &size));
+        EXPECT_EQ_INT(XJSON_PARSE_ROOT_NOT_SINGULAR, xjson_required_size("[1] x", 5, &size));
+        EXPECT_EQ_INT(XJSON_PARSE_INVALID_VALUE, xjson_parse_static(&v, "[1,]", 4, buf, sizeof(buf)));
+        EXPECT_EQ_INT(XJSON_PARSE_ROOT_NOT_SINGULAR, xjson_parse_static(&v, "[1] x", 5, buf, sizeof(buf)));
+        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&v));
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse_static(&v, "true", 4, NULL, 0));
+        EXPECT_EQ_INT(XJSON_TRUE, xjson_get_type(&v));
+
+        /* 空缓冲区不能退回malloc */
+        EXPECT_EQ_INT(XJSON_PARSE_OUT_OF_MEMORY, xjson_parse_static(&v, "\"hello world\"", 13, NULL, 0));
+        EXPECT_EQ_INT(XJSON_PARSE_OUT_OF_MEMORY, xjson_parse_static(&v, "[\"hello world\",[1,2,3]]", 23, NULL, 0));
+        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&v));
+}
+
+typedef struct {
+        char buf[XJSON_WRITER_BUFFER_SIZE * 3];
+        size_t len, calls;
+        int fail;
+}test_sink_buffer;
+
+static int test_sink(void *user, const char *data, size_t len) {
+        test_sink_buffer *b = (test_sink_buffer *)user;
+        if (b->fail || b->len + len > sizeof(b->buf)) {
+                return -1;
+        }
+        memcpy(b->buf + b->len, data, len);
+        b->len += len;
+        b->calls++;
+        return 0;
+}
+
+typedef struct {
+        char *buf;
+        size_t len, cap;
+}test_grow_buffer;
+
+static int test_grow_sink(void *user, const char *data, size_t len) {
+        test_grow_buffer *b = (test_grow_buffer *)user;
+        if (b->len + len > b->cap) {
+                b->cap = (b->len + len) * 2;
+                b->buf = (char *)realloc(b->buf, b->cap);
+        }
+        memcpy(b->buf + b->len, data, len);
+        b->len += len;
+        return 0;
+}
+
+static void test_writer_parallel_case(const xjson_value *v, unsigned threads) {
+        test_grow_buffer seq = { NULL, 0, 0 }, par = { NULL, 0, 0 };
+        xjson_writer w;
+
+        xjson_writer_init(&w, test_grow_sink, &seq);
+        xjson_writer_value(&w, v);
+        xjson_writer_value(&w, v);
+        EXPECT_TRUE(xjson_writer_flush(&w));
+
+        xjson_writer_init(&w, test_grow_sink, &par);
+        xjson_writer_value_parallel(&w, v, threads);
+        xjson_writer_value_parallel(&w, v, threads);
+        EXPECT_TRUE(xjson_writer_flush(&w));
+
+        EXPECT_EQ_SIZE_T(seq.len, par.len);
+        EXPECT_TRUE(seq.len == par.len && memcmp(seq.buf, par.buf, seq.len) == 0);
+        free(seq.buf);
+        free(par.buf);
+}
+
+static void test_writer_parallel() {
+        xjson_value v, *big, *nested;
+
+        /* [大array, 小成员, [大array, []], 大array] */
+        xjson_init(&v);
+        xjson_set_array(&v, 0);
+        big = xjson_pushback_array_element(&v);
+        xjson_set_array(big, 0);
+        for (int i = 0; i < 40000; i++) {
+                xjson_value *e = xjson_pushback_array_element(big);
+                if (i % 3 == 0) {
+                        xjson_set_string(e, "x\"y\n", 4);
+                } else if (i % 3 == 1) {
+                        xjson_set_number(e, i * 0.25);
+                } else {
+                        xjson_set_array(e, 0);
+                        xjson_set_boolean(xjson_pushback_array_element(e), i % 2);
+                }
+        }
+        xjson_set_number(xjson_pushback_array_element(&v), 1);
+        nested = xjson_pushback_array_element(&v);
+        xjson_set_array(nested, 0);
+        xjson_copy(xjson_pushback_array_element(nested), big);
+        xjson_set_array(xjson_pushback_array_element(nested), 0);
+        xjson_copy(xjson_pushback_array_element(&v), big);
+
+        test_writer_parallel_case(&v, 1);
+        test_writer_parallel_case(&v, 4);
+        test_writer_parallel_case(xjson_get_array_element(&v, 1), 4);
+        xjson_free(&v);
+}
+
+static void test_writer_deep() {
+        test_grow_buffer b = { NULL, 0, 0 };
+        xjson_writer w;
+        xjson_value v, *e;
+        char json[2 * (XJSON_WRITER_MAX_DEPTH + 36) + 2];
+        int depth = XJSON_WRITER_MAX_DEPTH + 36;
+
+        /* 解析得到的深层array可以完整输出 */
+        memset(json, '[', depth);
+        json[depth] = '1';
+        memset(json + depth + 1, ']', depth);
+        json[2 * depth + 1] = '\0';
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, json));
+        xjson_writer_init(&w, test_grow_sink, &b);
+        xjson_writer_value(&w, &v);
+        EXPECT_TRUE(xjson_writer_flush(&w));
+        EXPECT_EQ_SIZE_T(strlen(json), b.len);
+        EXPECT_TRUE(b.len == strlen(json) && memcmp(b.buf, json, b.len) == 0);
+
+        /* 拆分经过的array不占用输出器的嵌套层 */
+        xjson_free(&v);
+        xjson_set_array(&v, 0);
+        e = &v;
+        for (int i = 0; i < depth; i++) {
+                xjson_set_number(xjson_pushback_array_element(e), i);
+                e = xjson_pushback_array_element(e);
+                xjson_set_array(e, 0);
+        }
+        for (int i = 0; i < 20000; i++) {
+                xjson_set_number(xjson_pushback_array_element(e), i * 0.5);
+        }
+        test_writer_parallel_case(&v, 4);
+        xjson_free(&v);
+
+        /* 逐个输出时超过最大层数置错误，各层仍可正常结束 */
+        b.len = 0;
+        xjson_writer_init(&w, test_grow_sink, &b);
+        for (int i = 0; i < depth; i++) {
+                xjson_writer_begin_object(&w);
+                xjson_writer_key(&w, "k", 1);
+        }
+        xjson_writer_null(&w);
+        for (int i = 0; i < depth; i++) {
+                xjson_writer_end_object(&w);
+        }
+        EXPECT_FALSE(xjson_writer_flush(&w));
+        EXPECT_EQ_SIZE_T(0, w.depth);
+        free(b.buf);
+}
+
+static void test_writer() {
+        static test_sink_buffer b;
+        static char big[XJSON_WRITER_BUFFER_SIZE + 1];
+        xjson_writer w;
+        xjson_parser p;
+        xjson_value v;
+        const char *json = "[1, -0, 123456789012345678901234567890, [\"\\u0001\"], [], 1.5e300]";
+        char line[256];
+        FILE *fp;
+
+        xjson_writer_init(&w, test_sink, &b);
+        xjson_writer_begin_object(&w);
+        xjson_writer_key(&w, "id", 2);
+        xjson_writer_number(&w, 42);
+        xjson_writer_key(&w, "k\"\\", 3);
+        xjson_writer_begin_array(&w);
+        xjson_writer_null(&w);
+        xjson_writer_boolean(&w, xjson_true);
+        xjson_writer_boolean(&w, xjson_false);
+        xjson_writer_number(&w, -0.0);
+        xjson_writer_number(&w, 0.1);
+        xjson_writer_number(&w, -9007199254740992.0);
+        xjson_writer_number(&w, 1e300);
+        xjson_writer_number(&w, HUGE_VAL);
+        xjson_writer_string(&w, "a\0b\n\x1f\xE2\x82\xAC", 8);
+        xjson_writer_raw(&w, "{\"x\":[1]}", 9);
+        xjson_writer_begin_object(&w);
+        xjson_writer_end_object(&w);
+        xjson_writer_end_array(&w);
+        xjson_writer_end_object(&w);
+        xjson_writer_begin_array(&w);
+        xjson_writer_end_array(&w);
+        EXPECT_TRUE(xjson_writer_flush(&w));
+        EXPECT_EQ_STRING("{\"id\":42,\"k\\\"\\\\\":[null,true,false,-0,0.10000000000000001,"
+                "-9007199254740992,1.0000000000000001e+300,null,\"a\\u0000b\\n\\u001F\xE2\x82\xAC\","
+                "{\"x\":[1]},{}]}\n[]", b.buf, b.len);
+
+        /* 延迟转换的number原样输出 */
+        xjson_parser_init(&p);
+        p.flags = XJSON_PARSER_LAZY_NUMBERS;
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parser_parse(&p, &v, json, strlen(json)));
+        b.len = 0;
+        xjson_writer_init(&w, test_sink, &b);
+        xjson_writer_value(&w, &v);
+        EXPECT_TRUE(xjson_writer_flush(&w));
+        EXPECT_EQ_STRING("[1,-0,123456789012345678901234567890,[\"\\u0001\"],[],1.5e300]", b.buf, b.len);
+        xjson_free(&v);
+        xjson_parser_free(&p);
+
+        /* 缓冲区大小固定，超过缓冲区的数据直接输出 */
+        memset(big, 'x', sizeof(big));
+        b.len = b.calls = 0;
+        xjson_writer_init(&w, test_sink, &b);
+        xjson_writer_begin_array(&w);
+        xjson_writer_string(&w, big, 10);
+        xjson_writer_raw(&w, big, sizeof(big));
+        xjson_writer_string(&w, big, sizeof(big));
+        xjson_writer_end_array(&w);
+        EXPECT_TRUE(xjson_writer_flush(&w));
+        EXPECT_EQ_SIZE_T(1 + 12 + 1 + sizeof(big) + 1 + sizeof(big) + 2 + 1, b.len);
+        EXPECT_TRUE(b.calls >= 3);
+
+        /* 输出函数失败 */
+        b.fail = 1;
+        xjson_writer_init(&w, test_sink, &b);
+        xjson_writer_raw(&w, big, sizeof(big));
+        xjson_writer_null(&w);
+        EXPECT_FALSE(xjson_writer_flush(&w));
+        b.fail = 0;
+
+        fp = tmpfile();
+        if (fp != NULL) {
+                xjson_writer_init_file(&w, fp);
+                xjson_writer_begin_array(&w);
+                xjson_writer_number(&w, 1);
+                xjson_writer_string(&w, "a", 1);
+                xjson_writer_end_array(&w);
+                EXPECT_TRUE(xjson_writer_flush(&w));
+                rewind(fp);
+                EXPECT_TRUE(fgets(line, sizeof(line), fp) != NULL);
+                EXPECT_EQ_STRING("[1,\"a\"]", line, strlen(line));
+                fclose(fp);
+        }
+}
+
+#ifdef XJSON_ENABLE_THREADS
+static xjson_shared_slot *test_slot;
+
+/* slot为空时退出 */
+static void *test_shared_reader(void *arg) {
+        size_t *bad = (size_t *)arg;
+        xjson_shared_doc *d;
+        while ((d = xjson_shared_load(test_slot)) != NULL) {
+                const xjson_value *root = xjson_shared_root(d);
+                size_t n = xjson_get_array_size(root);
+                if (n == 0 || xjson_get_number(xjson_get_array_element(root, n - 1)) != (double)n) {
+                        ++*bad;
+                }
+                xjson_shared_release(d);
+        }
+        return NULL;
+}
+#endif
+
+static void test_shared() {
+        xjson_shared_doc *d, *old;
+        xjson_shared_slot *s;
+        xjson_parser p;
+        xjson_value v;
+        char json[] = "[1, 2.5, \"a\"]";
+
+        /* 延迟转换的number在创建时转换，不再引用json字符串 */
+        xjson_parser_init(&p);
+        p.flags = XJSON_PARSER_LAZY_NUMBERS;
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parser_parse(&p, &v, json, strlen(json)));
+        d = xjson_shared_create(&v);
+        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&v));
+        memset(json, ' ', sizeof(json) - 1);
+        EXPECT_EQ_DOUBLE(2.5, xjson_get_number(xjson_get_array_element(xjson_shared_root(d), 1)));
+        EXPECT_TRUE(xjson_get_number_literal(xjson_get_array_element(xjson_shared_root(d), 1), NULL) == NULL);
+        xjson_parser_free(&p);
+
+        s = xjson_shared_slot_create(xjson_shared_retain(d));
+        old = xjson_shared_load(s);
+        EXPECT_TRUE(old == d);
+        xjson_shared_release(old);
+
+        xjson_set_number(&v, 7);
+        old = xjson_shared_swap(s, xjson_shared_create(&v));
+        EXPECT_TRUE(old == d);
+        xjson_shared_release(old);
+        EXPECT_EQ_SIZE_T(3, xjson_get_array_size(xjson_shared_root(d)));
+        xjson_shared_release(d);
+
+        d = xjson_shared_load(s);
+        EXPECT_EQ_DOUBLE(7.0, xjson_get_number(xjson_shared_root(d)));
+        xjson_shared_release(d);
+        xjson_shared_slot_free(s);
+
+        s = xjson_shared_slot_create(NULL);
+        EXPECT_TRUE(xjson_shared_load(s) == NULL);
+        xjson_shared_slot_free(s);
+
+#ifdef XJSON_ENABLE_THREADS
+        /* 读者与热更新并发，每个版本最后一个成员等于成员个数 */
+        pthread_t tid[4];
+        size_t bad[4] = { 0 };
+
+        xjson_set_array(&v, 0);
+        xjson_set_number(xjson_pushback_array_element(&v), 1);
+        test_slot = xjson_shared_slot_create(xjson_shared_create(&v));
+        for (int i = 0; i < 4; i++) {
+                pthread_create(&tid[i], NULL, test_shared_reader, &bad[i]);
+        }
+        for (int n = 2; n <= 2000; n++) {
+                xjson_set_array(&v, n);
+                for (int i = 1; i <= n; i++) {
+                        xjson_set_number(xjson_pushback_array_element(&v), i);
+                }
+                xjson_shared_release(xjson_shared_swap(test_slot, xjson_shared_create(&v)));
+        }
+        xjson_shared_release(xjson_shared_swap(test_slot, NULL));
+        for (int i = 0; i < 4; i++) {
+                pthread_join(tid[i], NULL);
+                EXPECT_EQ_SIZE_T(0, bad[i]);
+        }
+        xjson_shared_slot_free(test_slot);
+#endif
+}
+
 static void test_parse() {
         test_parse_null();
         test_parse_true();
@@ -234,6 +1096,8 @@ static void test_parse() {
         test_parse_number();
         test_parse_string();
         test_parse_array();
+        test_parse_projected();
+        test_parse_static();
         
         test_parse_expect_value();
         test_parse_invalid_value();
@@ -241,6 +1105,9 @@ static void test_parse() {
         test_parse_number_too_big();
         test_parse_missing_quotation_mark();
         test_parse_invalid_string_escape();
+        test_parse_invalid_unicode_hex();
+        test_parse_invalid_unicode_surrogate();
+        test_parse_invalid_utf8();
         test_parse_invalid_string_char();
         test_parse_miss_comma_or_square_bracket();
 }
@@ -282,15 +1149,565 @@ static void test_access_string() {
         xjson_free(&v);
 }
 
+static void test_move() {
+        xjson_value v1, v2, v3;
+        xjson_init(&v1);
+        xjson_init(&v2);
+        xjson_init(&v3);
+        xjson_parse(&v1, "[1, \"abc\", [true]]");
+        xjson_set_string(&v2, "Hello", 5);
+
+        xjson_move(&v2, &v1);
+        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&v1));
+        EXPECT_EQ_INT(XJSON_ARRAY, xjson_get_type(&v2));
+        EXPECT_EQ_SIZE_T(3, xjson_get_array_size(&v2));
+
+        /* 将成员转移至其所在的array */
+        xjson_move(&v3, &v2);
+        xjson_move(&v3, xjson_get_array_element(&v3, 1));
+        EXPECT_EQ_STRING("abc", xjson_get_string(&v3), xjson_get_string_length(&v3));
+        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&v2));
+
+        xjson_free(&v1);
+        xjson_free(&v2);
+        xjson_free(&v3);
+}
+
+static void test_swap() {
+        xjson_value v1, v2;
+        xjson_init(&v1);
+        xjson_init(&v2);
+        xjson_set_string(&v1, "Hello", 5);
+        xjson_parse(&v2, "[1, 2]");
+
+        xjson_swap(&v1, &v2);
+        EXPECT_EQ_INT(XJSON_ARRAY, xjson_get_type(&v1));
+        EXPECT_EQ_STRING("Hello", xjson_get_string(&v2), xjson_get_string_length(&v2));
+
+        xjson_free(&v1);
+        xjson_free(&v2);
+}
+
+static void test_copy() {
+        xjson_value v1, v2, *e;
+        xjson_init(&v1);
+        xjson_init(&v2);
+        xjson_parse(&v1, "[null, false, 1.5, \"abc\", [[], [\"x\"]]]");
+
+        xjson_copy(&v2, &v1);
+        xjson_free(&v1);
+        EXPECT_EQ_SIZE_T(5, xjson_get_array_size(&v2));
+        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(xjson_get_array_element(&v2, 0)));
+        EXPECT_EQ_INT(XJSON_FALSE, xjson_get_type(xjson_get_array_element(&v2, 1)));
+        EXPECT_EQ_DOUBLE(1.5, xjson_get_number(xjson_get_array_element(&v2, 2)));
+        EXPECT_EQ_STRING("abc", xjson_get_string(xjson_get_array_element(&v2, 3)),
+                xjson_get_string_length(xjson_get_array_element(&v2, 3)));
+
+        /* 将成员拷贝至其所在的array */
+        xjson_copy(&v2, xjson_get_array_element(&v2, 4));
+        EXPECT_EQ_SIZE_T(2, xjson_get_array_size(&v2));
+        EXPECT_EQ_SIZE_T(0, xjson_get_array_size(xjson_get_array_element(&v2, 0)));
+        e = xjson_get_array_element(xjson_get_array_element(&v2, 1), 0);
+        EXPECT_EQ_STRING("x", xjson_get_string(e), xjson_get_string_length(e));
+
+        xjson_free(&v2);
+
+        /* 延迟转换的number拷贝后不再引用json字符串 */
+        xjson_parser p;
+        char *json = strdup("[12345.678]");
+        xjson_parser_init(&p);
+        p.flags = XJSON_PARSER_LAZY_NUMBERS;
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parser_parse(&p, &v1, json, strlen(json)));
+        xjson_copy(&v2, &v1);
+        xjson_free(&v1);
+        xjson_parser_free(&p);
+        free(json);
+        e = xjson_get_array_element(&v2, 0);
+        EXPECT_TRUE(xjson_get_number_literal(e, NULL) == NULL);
+        EXPECT_EQ_DOUBLE(12345.678, xjson_get_number(e));
+        xjson_free(&v2);
+}
+
+#define TEST_EQUAL(json1, json2, equality)\
+        do {\
+                xjson_value v1, v2;\
+                xjson_init(&v1);\
+                xjson_init(&v2);\
+                EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v1, json1));\
+                EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v2, json2));\
+                EXPECT_EQ_INT(equality, xjson_equal(&v1, &v2));\
+                EXPECT_EQ_INT(equality, xjson_hash(&v1) == xjson_hash(&v2));\
+                xjson_free(&v1);\
+                xjson_free(&v2);\
+        } while(0)
+
+static void test_equal() {
+        TEST_EQUAL("true", "true", 1);
+        TEST_EQUAL("true", "false", 0);
+        TEST_EQUAL("false", "false", 1);
+        TEST_EQUAL("null", "null", 1);
+        TEST_EQUAL("null", "0", 0);
+        TEST_EQUAL("123", "123", 1);
+        TEST_EQUAL("123", "456", 0);
+        TEST_EQUAL("0", "-0", 1);
+        TEST_EQUAL("\"abc\"", "\"abc\"", 1);
+        TEST_EQUAL("\"abc\"", "\"abd\"", 0);
+        TEST_EQUAL("\"abc\"", "\"abcd\"", 0);
+        TEST_EQUAL("\"a long string over 8 bytes\"", "\"a long string over 8 bytes\"", 1);
+        TEST_EQUAL("[]", "[]", 1);
+        TEST_EQUAL("[]", "null", 0);
+        TEST_EQUAL("[1,2,3]", "[1,2,3]", 1);
+        TEST_EQUAL("[1,2,3]", "[1,2,3,4]", 0);
+        TEST_EQUAL("[1,2,3]", "[3,2,1]", 0);
+        TEST_EQUAL("[[]]", "[[]]", 1);
+        TEST_EQUAL("[[], \"\"]", "[\"\", []]", 0);
+}
+
+static void test_equal_memoized() {
+        const char *json = "[0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,[\"a\"]]";
+        xjson_value v1, v2;
+        xjson_hash_memo m;
+        xjson_init(&v1);
+        xjson_init(&v2);
+        xjson_hash_memo_init(&m);
+        xjson_parse(&v1, json);
+        xjson_parse(&v2, json);
+
+        EXPECT_TRUE(xjson_equal_memoized(&v1, &v2, &m));
+        EXPECT_EQ_SIZE_T(2, m.count);
+        EXPECT_TRUE(xjson_hash_memoized(&v1, &m) == xjson_hash(&v1));
+        EXPECT_TRUE(xjson_equal_memoized(&v1, &v2, &m));
+        EXPECT_EQ_SIZE_T(2, m.count);
+
+        /* 修改后须清空缓存 */
+        xjson_set_string(xjson_get_array_element(&v2, 16), "b", 1);
+        xjson_hash_memo_clear(&m);
+        EXPECT_FALSE(xjson_equal_memoized(&v1, &v2, &m));
+
+        xjson_hash_memo_free(&m);
+        xjson_free(&v1);
+        xjson_free(&v2);
+}
+
+static void test_access_array() {
+        xjson_value a, e;
+        size_t i, j;
+
+        xjson_init(&a);
+
+        for (j = 0; j <= 5; j += 5) {
+                xjson_set_array(&a, j);
+                EXPECT_EQ_SIZE_T(0, xjson_get_array_size(&a));
+                EXPECT_EQ_SIZE_T(j, xjson_get_array_capacity(&a));
+                for (i = 0; i < 10; i++) {
+                        xjson_set_number(xjson_pushback_array_element(&a), i);
+                }
+
+                EXPECT_EQ_SIZE_T(10, xjson_get_array_size(&a));
+                for (i = 0; i < 10; i++)
+                        EXPECT_EQ_DOUBLE((double)i, xjson_get_number(xjson_get_array_element(&a, i)));
+        }
+
+        xjson_erase_array_element(&a, 4, 0);
+        EXPECT_EQ_SIZE_T(10, xjson_get_array_size(&a));
+        for (i = 0; i < 10; i++)
+                EXPECT_EQ_DOUBLE((double)i, xjson_get_number(xjson_get_array_element(&a, i)));
+
+        xjson_erase_array_element(&a, 8, 2);
+        EXPECT_EQ_SIZE_T(8, xjson_get_array_size(&a));
+        for (i = 0; i < 8; i++)
+                EXPECT_EQ_DOUBLE((double)i, xjson_get_number(xjson_get_array_element(&a, i)));
+
+        xjson_erase_array_element(&a, 0, 2);
+        EXPECT_EQ_SIZE_T(6, xjson_get_array_size(&a));
+        for (i = 0; i < 6; i++)
+                EXPECT_EQ_DOUBLE((double)i + 2, xjson_get_number(xjson_get_array_element(&a, i)));
+
+        for (i = 0; i < 2; i++) {
+                xjson_set_number(xjson_insert_array_element(&a, i), i);
+        }
+        EXPECT_EQ_SIZE_T(8, xjson_get_array_size(&a));
+        for (i = 0; i < 8; i++)
+                EXPECT_EQ_DOUBLE((double)i, xjson_get_number(xjson_get_array_element(&a, i)));
+
+        EXPECT_TRUE(xjson_get_array_capacity(&a) > 8);
+        xjson_shrink_array(&a);
+        EXPECT_EQ_SIZE_T(8, xjson_get_array_capacity(&a));
+        EXPECT_EQ_SIZE_T(8, xjson_get_array_size(&a));
+        for (i = 0; i < 8; i++)
+                EXPECT_EQ_DOUBLE((double)i, xjson_get_number(xjson_get_array_element(&a, i)));
+
+        /* 成员被移动，而非复制 */
+        xjson_init(&e);
+        xjson_set_string(&e, "Hello", 5);
+        xjson_move(xjson_pushback_array_element(&a), &e);
+        EXPECT_EQ_INT(XJSON_NULL, xjson_get_type(&e));
+        xjson_set_string(&e, "World", 5);
+        xjson_move(xjson_insert_array_element(&a, 0), &e);
+        EXPECT_EQ_SIZE_T(10, xjson_get_array_size(&a));
+        EXPECT_EQ_STRING("World", xjson_get_string(xjson_get_array_element(&a, 0)), 5);
+        EXPECT_EQ_STRING("Hello", xjson_get_string(xjson_get_array_element(&a, 9)), 5);
+
+        xjson_erase_array_element(&a, 0, xjson_get_array_size(&a));
+        EXPECT_EQ_SIZE_T(0, xjson_get_array_size(&a));
+        xjson_shrink_array(&a);
+        EXPECT_EQ_SIZE_T(0, xjson_get_array_capacity(&a));
+
+        xjson_reserve_array(&a, 16);
+        EXPECT_EQ_SIZE_T(16, xjson_get_array_capacity(&a));
+        xjson_reserve_array(&a, 8);
+        EXPECT_EQ_SIZE_T(16, xjson_get_array_capacity(&a));
+
+        xjson_free(&a);
+}
+
+static void test_accessor() {
+        xjson_accessor root = xjson_accessor_create("");
+        xjson_accessor acc = xjson_accessor_create("/1/0");
+        xjson_accessor deep = xjson_accessor_create("/1/10/0");
+        xjson_value v;
+
+        xjson_init(&v);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, "[0, [\"a\", 1, 2, 3, 4, 5, 6, 7, 8, 9, [true]]]"));
+        EXPECT_TRUE(xjson_accessor_get(&root, &v) == &v);
+        EXPECT_EQ_STRING("a", xjson_get_string(xjson_accessor_get(&acc, &v)), 1);
+        EXPECT_EQ_INT(XJSON_TRUE, xjson_get_type(xjson_accessor_get(&deep, &v)));
+        xjson_free(&v);
+
+        /* 路径不存在 */
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, "[0, 1]"));
+        EXPECT_TRUE(xjson_accessor_get(&acc, &v) == NULL);
+        EXPECT_TRUE(xjson_accessor_get(&deep, &v) == NULL);
+        xjson_free(&v);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, "[0, []]"));
+        EXPECT_TRUE(xjson_accessor_get(&acc, &v) == NULL);
+        xjson_free(&v);
+
+        /* 超过最大层数的路径不指向任何成员，根对象也不例外 */
+        char path[4 * XJSON_ACCESSOR_MAX_DEPTH + 8] = "";
+        for (int i = 0; i <= XJSON_ACCESSOR_MAX_DEPTH; i++) {
+                strcat(path, "/0");
+        }
+        xjson_accessor over = xjson_accessor_create(path);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, "[[[[[[[[[[[[[[[[[[[[0]]]]]]]]]]]]]]]]]]]]"));
+        EXPECT_TRUE(xjson_accessor_get(&over, &v) == NULL);
+        xjson_free(&v);
+        xjson_set_array(&v, 0);
+        EXPECT_TRUE(xjson_accessor_get(&over, &v) == NULL);
+        xjson_free(&v);
+}
+
+static xjson_patch patch_op(xjson_patch_op op, const char *path, const char *from, const char *value) {
+        xjson_patch p;
+
+        p.op = op;
+        p.path = path;
+        p.from = from;
+        xjson_init(&p.value);
+        if (value != NULL) {
+                EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&p.value, value));
+        }
+
+        return p;
+}
+
+static void test_apply_patch_case(int expect, const char *before, const char *after, xjson_patch *ops, size_t n) {
+        xjson_value v, e;
+
+        xjson_init(&v);
+        xjson_init(&e);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, before));
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&e, expect == XJSON_PARSE_OK ? after : before));
+        EXPECT_EQ_INT(expect, xjson_apply_patch(&v, ops, n));
+        EXPECT_TRUE(xjson_equal(&v, &e));
+        xjson_free(&v);
+        xjson_free(&e);
+        for (size_t i = 0; i < n; i++) {
+                xjson_free(&ops[i].value);
+        }
+}
+
+#define TEST_PATCH(expect, before, after, ...)\
+        do {\
+                xjson_patch ops[] = { __VA_ARGS__ };\
+                test_apply_patch_case(expect, before, after, ops, sizeof(ops) / sizeof(ops[0]));\
+        } while(0)
+
+static void test_apply_patch() {
+        const char *doc = "[1, [2, 3], \"a\"]";
+
+        TEST_PATCH(XJSON_PARSE_OK, doc, "[1, [2, 3], \"a\", null]", patch_op(XJSON_PATCH_ADD, "/-", NULL, "null"));
+        TEST_PATCH(XJSON_PARSE_OK, doc, "[1, [2, [], 3], \"a\"]", patch_op(XJSON_PATCH_ADD, "/1/1", NULL, "[]"));
+        TEST_PATCH(XJSON_PARSE_OK, doc, "true", patch_op(XJSON_PATCH_ADD, "", NULL, "true"));
+        TEST_PATCH(XJSON_PARSE_OK, doc, "[1, \"a\"]", patch_op(XJSON_PATCH_REMOVE, "/1", NULL, NULL));
+        TEST_PATCH(XJSON_PARSE_OK, doc, "[1, [2, false], \"a\"]", patch_op(XJSON_PATCH_REPLACE, "/1/1", NULL, "false"));
+        TEST_PATCH(XJSON_PARSE_OK, doc, "[[2, 3], \"a\", 1]", patch_op(XJSON_PATCH_MOVE, "/2", "/0", NULL));
+        TEST_PATCH(XJSON_PARSE_OK, doc, "[1, [2, 3, \"a\"]]", patch_op(XJSON_PATCH_MOVE, "/1/-", "/2", NULL));
+        TEST_PATCH(XJSON_PARSE_OK, doc, "[2, 3]", patch_op(XJSON_PATCH_MOVE, "", "/1", NULL));
+        TEST_PATCH(XJSON_PARSE_OK, doc, "[1, [2, 3, [2, 3]], \"a\"]", patch_op(XJSON_PATCH_COPY, "/1/2", "/1", NULL));
+        TEST_PATCH(XJSON_PARSE_OK, doc, doc, patch_op(XJSON_PATCH_TEST, "/1", NULL, "[2, 3]"));
+        TEST_PATCH(XJSON_PARSE_OK, doc, "[1, [4], \"b\"]",
+                patch_op(XJSON_PATCH_REPLACE, "/2", NULL, "\"b\""),
+                patch_op(XJSON_PATCH_REMOVE, "/1/0", NULL, NULL),
+                patch_op(XJSON_PATCH_REPLACE, "/1/0", NULL, "4"));
+
+        /* 失败时撤销之前的全部操作 */
+        TEST_PATCH(XJSON_PATCH_TEST_FAILED, doc, NULL,
+                patch_op(XJSON_PATCH_ADD, "", NULL, "[9]"),
+                patch_op(XJSON_PATCH_MOVE, "/-", "/0", NULL),
+                patch_op(XJSON_PATCH_TEST, "/0", NULL, "8"));
+        TEST_PATCH(XJSON_PATCH_PATH_NOT_FOUND, doc, NULL,
+                patch_op(XJSON_PATCH_REMOVE, "/0", NULL, NULL),
+                patch_op(XJSON_PATCH_MOVE, "/0/5", "/1", NULL));
+        TEST_PATCH(XJSON_PATCH_PATH_NOT_FOUND, doc, NULL,
+                patch_op(XJSON_PATCH_MOVE, "/2", "/0", NULL),
+                patch_op(XJSON_PATCH_REPLACE, "/0/0", NULL, "0"),
+                patch_op(XJSON_PATCH_COPY, "/0", "/-", NULL));
+        TEST_PATCH(XJSON_PATCH_PATH_NOT_FOUND, doc, NULL, patch_op(XJSON_PATCH_ADD, "/5", NULL, "0"));
+        TEST_PATCH(XJSON_PATCH_PATH_NOT_FOUND, doc, NULL, patch_op(XJSON_PATCH_REMOVE, "", NULL, NULL));
+        TEST_PATCH(XJSON_PATCH_PATH_NOT_FOUND, doc, NULL, patch_op(XJSON_PATCH_REPLACE, "/-", NULL, "0"));
+        TEST_PATCH(XJSON_PATCH_INVALID_PATH, doc, NULL, patch_op(XJSON_PATCH_MOVE, "/1/0", "/1", NULL));
+        TEST_PATCH(XJSON_PATCH_INVALID_PATH, doc, NULL, patch_op(XJSON_PATCH_ADD, "/01", NULL, "0"));
+        TEST_PATCH(XJSON_PATCH_INVALID_PATH, doc, NULL, patch_op(XJSON_PATCH_ADD, "/-/0", NULL, "0"));
+        TEST_PATCH(XJSON_PATCH_INVALID_PATH, doc, NULL, patch_op(XJSON_PATCH_ADD, "0", NULL, "0"));
+
+        /* 未触及的成员只移动，不复制 */
+        xjson_value v;
+        xjson_patch op = patch_op(XJSON_PATCH_MOVE, "/0", "/1", NULL);
+        xjson_init(&v);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, doc));
+        xjson_value *e = xjson_get_array_element(&v, 1)->u.a.e;
+        const char *s = xjson_get_string(xjson_get_array_element(&v, 2));
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_apply_patch(&v, &op, 1));
+        EXPECT_TRUE(xjson_get_array_element(&v, 0)->u.a.e == e);
+        EXPECT_TRUE(xjson_get_string(xjson_get_array_element(&v, 2)) == s);
+        xjson_free(&v);
+}
+
+static void test_merge_patch() {
+        xjson_value v, p;
+
+        xjson_init(&v);
+        xjson_init(&p);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&v, "[1, [2]]"));
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&p, "[1, [2]]"));
+        xjson_value *e = v.u.a.e;
+        xjson_merge_patch(&v, &p);
+        EXPECT_TRUE(v.u.a.e == e);
+        xjson_free(&p);
+
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&p, "\"x\""));
+        xjson_merge_patch(&v, &p);
+        EXPECT_TRUE(xjson_equal(&v, &p));
+        xjson_free(&v);
+        xjson_free(&p);
+}
+
+static void test_diff_case(const char *a, const char *b, size_t count) {
+        xjson_value va, vb;
+        xjson_patch *ops;
+        size_t n;
+
+        xjson_init(&va);
+        xjson_init(&vb);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&va, a));
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&vb, b));
+        n = xjson_diff(&va, &vb, &ops);
+        EXPECT_EQ_SIZE_T(count, n);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_apply_patch(&va, ops, n));
+        EXPECT_TRUE(xjson_equal(&va, &vb));
+        xjson_free_patch(ops, n);
+        xjson_free(&va);
+        xjson_free(&vb);
+}
+
+static void test_diff() {
+        test_diff_case("[1, [2, 3], \"a\"]", "[1, [2, 3], \"a\"]", 0);
+        test_diff_case("1", "\"1\"", 1);
+        test_diff_case("[1, [2, 3], \"a\"]", "[1, [2, 4], \"a\"]", 1);
+        test_diff_case("[1, 2, 3, 4, 5]", "[1, 2, 9, 3, 4, 5]", 1);
+        test_diff_case("[1, 2, 3, 4, 5]", "[1, 3, 5]", 2);
+        test_diff_case("[1, 2, 3, 4, 5]", "[0, 1, 2, 4, 5, 6]", 3);
+        test_diff_case("[[1], [2], [3], [4]]", "[[2], [3, 0], [4], [1]]", 3);
+        test_diff_case("[]", "[1, [2], 3]", 3);
+        test_diff_case("[1, [2], 3]", "[]", 3);
+        test_diff_case("[true, false, null]", "[null, false, true]", 2);
+
+        /* 修改位于深处时，路径逐层指向它 */
+        xjson_value a, b;
+        xjson_patch *ops;
+        xjson_init(&a);
+        xjson_init(&b);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&a, "[0, [1, [2, [3]]]]"));
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&b, "[0, [1, [2, [4]]]]"));
+        EXPECT_EQ_SIZE_T(1, xjson_diff(&a, &b, &ops));
+        EXPECT_EQ_INT(XJSON_PATCH_REPLACE, ops[0].op);
+        EXPECT_TRUE(strcmp("/1/1/1/0", ops[0].path) == 0);
+        xjson_free_patch(ops, 1);
+        xjson_free(&a);
+        xjson_free(&b);
+
+        /* 超过XJSON_ACCESSOR_MAX_DEPTH层的修改在最深的可执行路径处整体替换 */
+        char ja[2 * (XJSON_ACCESSOR_MAX_DEPTH + 4) + 2], jb[sizeof(ja)];
+        int depth = XJSON_ACCESSOR_MAX_DEPTH + 4;
+        memset(ja, '[', depth);
+        ja[depth] = '1';
+        memset(ja + depth + 1, ']', depth);
+        ja[2 * depth + 1] = '\0';
+        memcpy(jb, ja, sizeof(ja));
+        jb[depth] = '2';
+        test_diff_case(ja, jb, 1);
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&a, ja));
+        EXPECT_EQ_INT(XJSON_PARSE_OK, xjson_parse(&b, jb));
+        EXPECT_EQ_SIZE_T(1, xjson_diff(&a, &b, &ops));
+        EXPECT_EQ_SIZE_T(2 * XJSON_ACCESSOR_MAX_DEPTH, strlen(ops[0].path));
+        xjson_free_patch(ops, 1);
+        xjson_free(&a);
+        xjson_free(&b);
+}
+
+#ifdef XJSON_ENABLE_THREADS
+static xjson_cache *test_cache_shared;
+
+/* 反复解析少量输入，结果须与输入一致 */
+static void *test_cache_reader(void *arg) {
+        size_t *bad = (size_t *)arg;
+
+        for (int i = 0; i < 2000; i++) {
+                char s[16];
+                int n = sprintf(s, "[%d]", i % 8);
+                xjson_shared_doc *d = xjson_cache_parse(test_cache_shared, s, n);
+                if (xjson_get_number(xjson_get_array_element(xjson_shared_root(d), 0)) != i % 8) {
+                        (*bad)++;
+                }
+                xjson_shared_release(d);
+        }
+        return NULL;
+}
+#endif
+
+static void test_cache() {
+        xjson_cache *c = xjson_cache_create(2, 1 << 20);
+        xjson_cache_stats st;
+        xjson_shared_doc *a, *b, *d;
+        char json[] = "[1, \"abc\", [true]]";
+
+        /* 相同内容命中，与输入地址无关 */
+        a = xjson_cache_parse(c, json, strlen(json));
+        EXPECT_TRUE(a != NULL);
+        b = xjson_cache_parse(c, "[1, \"abc\", [true]]", strlen(json));
+        EXPECT_TRUE(a == b);
+        xjson_shared_release(b);
+
+        /* 前缀不同于完整输入 */
+        b = xjson_cache_parse(c, "[1, \"abc\", [true]] ", strlen(json) + 1);
+        EXPECT_TRUE(b != NULL && b != a);
+        EXPECT_TRUE(xjson_equal(xjson_shared_root(a), xjson_shared_root(b)));
+        xjson_shared_release(b);
+
+        /* 解析失败不缓存 */
+        EXPECT_TRUE(xjson_cache_parse(c, "[1,", 3) == NULL);
+        EXPECT_TRUE(xjson_cache_parse(c, "[1,", 3) == NULL);
+        xjson_cache_get_stats(c, &st);
+        EXPECT_EQ_SIZE_T(1, st.hits);
+        EXPECT_EQ_SIZE_T(4, st.misses);
+        EXPECT_EQ_SIZE_T(0, st.evictions);
+        EXPECT_EQ_SIZE_T(2, st.entries);
+
+        /* 超出项数淘汰最久未使用的项，a刚被访问过所以保留 */
+        xjson_shared_release(xjson_cache_parse(c, json, strlen(json)));
+        xjson_shared_release(xjson_cache_parse(c, "null", 4));
+        xjson_cache_get_stats(c, &st);
+        EXPECT_EQ_SIZE_T(1, st.evictions);
+        EXPECT_EQ_SIZE_T(2, st.entries);
+        d = xjson_cache_parse(c, json, strlen(json));
+        EXPECT_TRUE(d == a);
+        xjson_shared_release(d);
+
+        /* 淘汰或释放缓存后，调用者持有的引用仍有效 */
+        xjson_cache_free(c);
+        EXPECT_EQ_STRING("abc", xjson_get_string(xjson_get_array_element(xjson_shared_root(a), 1)),\
+                        xjson_get_string_length(xjson_get_array_element(xjson_shared_root(a), 1)));
+        xjson_shared_release(a);
+
+        /* 超出内存上限淘汰，单项超过上限时不缓存 */
+        c = xjson_cache_create(100, 1024);
+        for (int i = 0; i < 50; i++) {
+                char s[32];
+                int n = sprintf(s, "[%d, \"x\"]", i);
+                d = xjson_cache_parse(c, s, n);
+                EXPECT_EQ_DOUBLE((double)i, xjson_get_number(xjson_get_array_element(xjson_shared_root(d), 0)));
+                xjson_shared_release(d);
+                xjson_cache_get_stats(c, &st);
+                EXPECT_TRUE(st.bytes <= 1024);
+        }
+        EXPECT_TRUE(st.evictions > 0);
+        EXPECT_EQ_SIZE_T(50, st.entries + st.evictions);
+
+        char big[2048];
+        memset(big, ' ', sizeof(big));
+        big[0] = '0';
+        d = xjson_cache_parse(c, big, sizeof(big));
+        EXPECT_EQ_DOUBLE(0.0, xjson_get_number(xjson_shared_root(d)));
+        xjson_shared_release(d);
+        xjson_cache_stats after;
+        xjson_cache_get_stats(c, &after);
+        EXPECT_EQ_SIZE_T(st.entries, after.entries);
+        EXPECT_EQ_SIZE_T(st.evictions, after.evictions);
+        xjson_cache_free(c);
+
+#ifdef XJSON_ENABLE_THREADS
+        /* 项数小于不同输入的个数，命中与淘汰并发 */
+        pthread_t tid[4];
+        size_t bad[4] = { 0 };
+
+        test_cache_shared = xjson_cache_create(4, 1 << 20);
+        for (int i = 0; i < 4; i++) {
+                pthread_create(&tid[i], NULL, test_cache_reader, &bad[i]);
+        }
+        for (int i = 0; i < 4; i++) {
+                pthread_join(tid[i], NULL);
+                EXPECT_EQ_SIZE_T(0, bad[i]);
+        }
+        xjson_cache_get_stats(test_cache_shared, &st);
+        EXPECT_EQ_SIZE_T(4 * 2000, st.hits + st.misses);
+        EXPECT_TRUE(st.entries <= 4);
+        xjson_cache_free(test_cache_shared);
+#endif
+}
+
 static void test_access() {
         test_access_null();
         test_access_boolean();
         test_access_number();
         test_access_string();
+        test_access_array();
+        test_accessor();
+
+        test_move();
+        test_swap();
+        test_copy();
+        test_equal();
+        test_equal_memoized();
+        test_apply_patch();
+        test_merge_patch();
+        test_diff();
 }
 
 int main() {
         test_parse();
+        test_kernel();
+        test_validate();
+        test_parser();
+        test_parse_lazy_number();
+        test_parse_batch();
+        test_reparse();
+        test_struct();
+        test_writer();
+        test_writer_parallel();
+        test_writer_deep();
+        test_shared();
+        test_cache();
         test_access();
 
         printf("%d/%d (%3.2f%%) passed\n",\
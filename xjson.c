@@ -1,24 +1,202 @@
 #include <assert.h>     // assert()
 #include <errno.h>      // errno, ERANGE
 #include <math.h>       // HUGE_VAL
+#include <stdatomic.h>  // atomic_fetch_add()
+#include <stdint.h>     // uint64_t
+#include <stdio.h>      // snprintf()
 #include <stdlib.h>     // NULL, strtod()
 #include <string.h>     // malloc()
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>     // write()
+#endif
+#ifdef XJSON_ENABLE_THREADS
+#include <pthread.h>    // pthread_create()
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XJSON_X86_DISPATCH
+#include <immintrin.h>  // _mm_loadu_si128(), _mm256_loadu_si256(), _mm512_loadu_si512()
+#endif
+
 #include "xjson.h"
 
-#define EXPECT(c, ch)	do { assert(*c->json == (ch)); c->json++; } while(0)
+#ifdef XJSON_ENABLE_STATS
+#define STAT_ADD(c, field, n)   do { if ((c)->stats) (c)->stats->field += (n); } while(0)
+#define STAT_MAX(c, field, n)   do {\
+                if ((c)->stats && (c)->stats->field < (n)) (c)->stats->field = (n);\
+        } while(0)
+#define STAT_SET(c, field, n)   do { if ((c)->stats) (c)->stats->field = (n); } while(0)
+#else
+#define STAT_ADD(c, field, n)   do { } while(0)
+#define STAT_MAX(c, field, n)   do { } while(0)
+#define STAT_SET(c, field, n)   do { } while(0)
+#endif
+
+#ifdef XJSON_ENABLE_STATS_TIMERS
+#ifndef XJSON_STATS_CLOCK
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>  // __rdtsc()
+#define XJSON_STATS_CLOCK()     ((uint64_t)__rdtsc())
+#else
+#include <time.h>       // clock()
+#define XJSON_STATS_CLOCK()     ((uint64_t)clock())
+#endif
+#endif
+#define TIMER_BEGIN(t)          uint64_t t = XJSON_STATS_CLOCK()
+#define TIMER_END(c, t, phase)  STAT_ADD(c, cycles[phase], XJSON_STATS_CLOCK() - (t))
+#else
+#define TIMER_BEGIN(t)          do { } while(0)
+#define TIMER_END(c, t, phase)  do { } while(0)
+#endif
+
+#define EXPECT(c, ch)	do { assert(PEEK(c) == (ch)); c->json++; } while(0)
+#define PEEK(c)         ((c)->json < (c)->end ? *(c)->json : '\0')
+#define CHAR_AT(p, end) ((p) < (end) ? *(p) : '\0')
 #define ISDIGIT(ch)     ((ch) >= '0' && (ch) <= '9')
 #define ISDIGITNZ(ch)   ((ch) >= '1' && (ch) <= '9')
-#define PUTC(c, ch)     do {\
-                *(char *)xjson_context_push(c, sizeof(char)) = (ch);\
-        } while(0)
+
+#define SWAR_ONES               ((uint64_t)-1 / 255)
+#define SWAR_HAS_LESS(x, n)     (((x) - SWAR_ONES * (n)) & ~(x) & (SWAR_ONES * 0x80))
+#define SWAR_HAS_BYTE(x, n)     SWAR_HAS_LESS((x) ^ (SWAR_ONES * (n)), 1)
+
+/* 2^1024 - 2^970 的全部有效数字：不小于该值的十进制数经 strtod 舍入后溢出 */
+static const char xjson_overflow_digits[] =
+        "17976931348623158079372897140530341507993413271003782693617377898044"
+        "49682927647509466490179775872070963302864166928879109465555478519404"
+        "02630657488671505820681908902000708383676273854845817711531764475730"
+        "27006985557136695962284291481986083493647529271907416844436551070434"
+        "2711559699508093042880177904174497792";
 
 typedef struct {
         const char      *json; 
+        const char      *end;
         char            *stack;
         size_t          size, top;
+        unsigned        flags;          // XJSON_PARSER_*
+        int             fixed;          // 在静态缓冲区中解析，不使用malloc
+        char            *heap;          // 静态缓冲区中结果区的起始位置
+        xjson_arena     *arena;         // 批量解析的结果区，不为NULL时优先使用
+        size_t          used, peak;     // 校验时模拟静态解析，结果区大小与缓冲区峰值
+#ifdef XJSON_ENABLE_STATS
+        xjson_stats     *stats;         // 为NULL时不统计
+        size_t          depth;
+#endif
 }xjson_context;
 
+/* 静态缓冲区中结果的对齐粒度 */
+typedef union {
+        double          d;
+        void            *p;
+        size_t          s;
+}xjson_align;
+
+#define ALIGN_UP(n)     (((n) + sizeof(xjson_align) - 1) & ~(sizeof(xjson_align) - 1))
+
+/* 结果区内存块头部，数据紧随其后 */
+typedef union xjson_chunk xjson_chunk;
+union xjson_chunk {
+        struct {
+                xjson_chunk     *next;
+                size_t          size;
+        }h;
+        xjson_align             align;
+};
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_arena_alloc
+        描述:   自结果区当前块分配内存，空间不足时分配新块
+
+        input:  a,              结果区
+                size,           分配的大小
+
+        output: a               分配后的结果区
+
+        return: success, 分配的内存
+                failure, malloc失败时返回NULL
+ *---------------------------------------------------------------------------*/
+static void *
+xjson_arena_alloc(xjson_arena *a, size_t size) {
+        size = ALIGN_UP(size);
+
+        if (size > (size_t)(a->end - a->top)) {
+                size_t n = size > XJSON_ARENA_CHUNK_SIZE ? size : XJSON_ARENA_CHUNK_SIZE;
+                xjson_chunk *chunk = (xjson_chunk *)malloc(sizeof(xjson_chunk) + n);
+                if (chunk == NULL) {
+                        return NULL;
+                }
+
+                chunk->h.next = (xjson_chunk *)a->chunks;
+                chunk->h.size = n;
+                a->chunks = chunk;
+                a->top = (char *)(chunk + 1);
+                a->end = a->top + n;
+        }
+
+        a->top += size;
+        return a->top - size;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_arena_clear
+        描述:   释放结果区的全部分配
+
+        input:  a,              结果区
+                keep,           是否保留当前块供复用
+
+        output: a               清空后的结果区
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_arena_clear(xjson_arena *a, int keep) {
+        xjson_chunk *chunk = (xjson_chunk *)a->chunks, *next;
+
+        if (keep && chunk != NULL) {
+                a->top = (char *)(chunk + 1);
+                a->end = a->top + chunk->h.size;
+                next = chunk->h.next;
+                chunk->h.next = NULL;
+                chunk = next;
+        } else {
+                a->chunks = NULL;
+                a->top = a->end = NULL;
+        }
+
+        for (; chunk != NULL; chunk = next) {
+                next = chunk->h.next;
+                free(chunk);
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_context_init
+        描述:   初始化json会话，会话栈为空，结果使用malloc分配
+
+        input:  c,              json会话
+                json,           json字符串
+                len,            json字符串长度
+
+        output: c               初始化后的json会话
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_context_init(xjson_context *c, const char *json, size_t len) {
+        c->json = json;
+        c->end = json + len;
+        c->stack = NULL;
+        c->size = c->top = 0;
+        c->flags = 0;
+        c->fixed = xjson_false;
+        c->heap = NULL;
+        c->arena = NULL;
+        c->used = c->peak = 0;
+#ifdef XJSON_ENABLE_STATS
+        c->stats = NULL;
+        c->depth = 0;
+#endif
+}
+
 /*---------------------------------------------------------------------------*
         函数名: xjson_context_push
         描述:   向当前json会话的栈中压入size大小的数据，并抬高栈指针
@@ -29,14 +207,19 @@ typedef struct {
         output: None
 
         return: success, 当前会话的栈顶指针
-                failure, 终止程序
+                failure, 静态缓冲区空间不足时返回NULL
  *---------------------------------------------------------------------------*/
 static void *
 xjson_context_push(xjson_context *c, size_t size) {
         void *ret;
         assert(size > 0);
 
-        if (c->top + size >= c->size) {
+        if (c->fixed) {
+                /* 静态缓冲区中栈与结果区相向增长 */
+                if (size > (size_t)(c->heap - c->stack) - c->top) {
+                        return NULL;
+                }
+        } else if (c->top + size >= c->size) {
                 if (c->size == 0) {
                         c->size = XJSON_PARSE_STACK_INIT_SIZE;
                 }
@@ -46,10 +229,12 @@ xjson_context_push(xjson_context *c, size_t size) {
                 }
 
                 c->stack = (char *)realloc(c->stack, c->size);
+                STAT_ADD(c, stack_reallocs, 1);
         }
 
         ret = c->stack + c->top;
         c->top += size;
+        STAT_MAX(c, stack_peak, c->top);
 
         return ret;
 }
@@ -74,332 +259,5833 @@ xjson_context_pop(xjson_context *c, size_t size) {
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_context_whitespace
-        描述:   读取并丢弃json字符串中的空白字符
+        函数名: xjson_context_alloc
+        描述:   为解析结果分配内存，批量解析时自结果区分配，静态缓冲区中
+                自结果区向低地址分配，否则使用malloc
 
         input:  c,              json会话
+                size,           分配的大小
 
-        output: c->json,        指向json字符串中第一个非空白字符
+        output: None
 
-        return: None
+        return: success, 分配的内存
+                failure, 静态缓冲区空间不足时返回NULL
  *---------------------------------------------------------------------------*/
-static void
-xjson_parse_whitespace(xjson_context *c) {
-        const char *p = c->json;
+static void *
+xjson_context_alloc(xjson_context *c, size_t size) {
+        STAT_ADD(c, allocs, 1);
+        STAT_ADD(c, alloc_bytes, size);
 
-        while (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r') {
-                p++;
+        if (c->arena != NULL) {
+                return xjson_arena_alloc(c->arena, size);
+        }
+        if (!c->fixed) {
+                return malloc(size);
         }
 
-        c->json = p;
+        size = ALIGN_UP(size);
+        if (size > (size_t)(c->heap - c->stack) - c->top) {
+                return NULL;
+        }
+
+        return c->heap -= size;
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_parse_literal
-        描述:   解析boolean和null类型
+        函数名: xjson_context_release
+        描述:   释放解析失败时已构建的json对象，静态缓冲区与结果区中的
+                对象无需释放
 
         input:  c,              json会话
-                v,              json对象，用于存储json解析结果
-                literal,        指定解析内容，可以为“true”、“false”或“null”
-                type,           指定解析类型，可以为XJSON_{TRUE|FALSE|NULL}
+                v,              json对象
 
-        output: v.type          json解析结果, 可以为XJSON_{TRUE|FALSE|NULL}
+        output: v               null
 
-        return: success, XJSON_PARSE_OK
-                failure, XJSON_PARSE_INVALID_VALUE
+        return: None
  *---------------------------------------------------------------------------*/
-static int
-xjson_parse_literal(
-                xjson_context *c,
-                xjson_value *v,
-                const char *literal,
-                xjson_type type) {
-
-        EXPECT(c, literal[0]);
-        
-        size_t i;
-        for (i = 0; literal[i+1]; i++) {
-                if (c->json[i] != literal[i+1]) {
-                        return XJSON_PARSE_INVALID_VALUE;
-                }
+static void
+xjson_context_release(xjson_context *c, xjson_value *v) {
+        if (!c->fixed && c->arena == NULL) {
+                xjson_free(v);
+        } else {
+                xjson_init(v);
         }
-
-        c->json += i;
-        v->type = type;
-
-        return XJSON_PARSE_OK;
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_parse_number
-        描述:   解析number类型
+        函数名: xjson_context_measure
+        描述:   校验时模拟静态解析的一次压栈与分配，记录缓冲区峰值
 
         input:  c,              json会话
-                v,              json对象，用于存储json解析结果
+                pushed,         暂存在栈顶的数据大小
+                size,           分配的大小，可以为0
 
-        output: v.type          json解析结果, 应为XJSON_NUMBER
-                v.number        json解析结果，存储双精度浮点型数值
+        output: c               结果区大小与缓冲区峰值
 
-        return: success, XJSON_PARSE_OK
-                failure, XJSON_PARSE_INVALID_VALUE ||
-                         XJSON_PARSE_NUMBER_TOO_BIG
+        return: None
  *---------------------------------------------------------------------------*/
-static int
-xjson_parse_number(xjson_context *c, xjson_value *v) {
-        const char *p = c->json;
-
-/*------------------------------校验number格式-------------------------------*/
-        if (*p == '-') p++;
-        if (*p == '0') p++;
-        else {
-                if (!ISDIGITNZ(*p)) return XJSON_PARSE_INVALID_VALUE;
-                for (p++; ISDIGIT(*p); p++);
+static void
+xjson_context_measure(xjson_context *c, size_t pushed, size_t size) {
+        c->used += ALIGN_UP(size);
+        if (c->peak < c->top + pushed + c->used) {
+                c->peak = c->top + pushed + c->used;
         }
+}
 
-        if (*p == '.') {
-                p++;
-                if (!ISDIGIT(*p)) return XJSON_PARSE_INVALID_VALUE;
-                for (p++; ISDIGIT(*p); p++);
-        }
+#define ISWHITESPACE(ch)        ((ch) == ' ' || (ch) == '\n' || (ch) == '\t' || (ch) == '\r')
 
-        if (*p == 'e' || *p == 'E') {
-                p++;
-                if (*p == '+' || *p == '-') p++;
-                if (!ISDIGIT(*p)) return XJSON_PARSE_INVALID_VALUE;
-                for (p++; ISDIGIT(*p); p++);                                
-        }
-/*---------------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*
+        函数名: xjson_skip_whitespace_scalar
+        描述:   跳过空白字符，逐字节比较
 
-        errno = 0;
+        input:  p,              起始位置
+                end,            json字符串结尾
 
-        v->u.number = strtod(c->json, NULL);
-        if (errno == ERANGE && (v->u.number == HUGE_VAL || v->u.number == -HUGE_VAL))
-                return XJSON_PARSE_NUMBER_TOO_BIG;
+        output: None
 
-        c->json = p;
-        v->type = XJSON_NUMBER;
+        return: 第一个非空白字符的位置，不存在时返回end
+ *---------------------------------------------------------------------------*/
+static const char *
+xjson_skip_whitespace_scalar(const char *p, const char *end) {
+        while (p < end && ISWHITESPACE(*p)) {
+                p++;
+        }
 
-        return XJSON_PARSE_OK;
+        return p;
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_parse_string
-        描述:   解析string类型
+        函数名: xjson_scan_string_scalar
+        描述:   跳过字符串中无需特殊处理的字符，每次比较8字节(SWAR)
 
-        input:  c,              json会话
-                v,              json对象，用于存储json解析结果
+        input:  p,              扫描起始位置
+                end,            json字符串结尾
+                ascii,          跳过的字符是否均为ASCII
 
-        output: v.type          json解析结果, 应为XJSON_STRING
-                v.u.s.string    json解析结果，存储字符串
-                v.u.s.length    json解析结果，存储字符串长度
+        output: ascii           跳过的字符中出现非ASCII字节时置为xjson_false，
+                                否则保持不变
 
-        return: success, XJSON_PARSE_OK
-                failure, XJSON_PARSE_INVALID_STRING_ESCAPE ||
-                         XJSON_PARSE_INVALID_STRING_CHAR ||
-                         XJSON_PARSE_MISS_QUOTATION_MARK
+        return: 第一个'"'、'\\'或控制字符的位置，不存在时返回end
  *---------------------------------------------------------------------------*/
-static int xjson_parse_string(xjson_context *c, xjson_value *v) {
-        EXPECT(c, '\"');
-
-        size_t head = c->top, len;
-        const char *p = c->json;
-        for (;;) {
-                char ch = *p++;
-                switch(ch) {
-                        case '\"':
-                                len = c->top - head;
-                                xjson_set_string(v, (const char *)xjson_context_pop(c, len), len);
-                                c->json = p;
-                                return XJSON_PARSE_OK;
-                        case '\\':
-                                switch (*p++) {
-                                        case '\"': PUTC(c, '\"'); break;
-                                        case '\\': PUTC(c, '\\'); break;
-                                        case '/':  PUTC(c, '/' ); break;
-                                        case 'b':  PUTC(c, '\b'); break;
-                                        case 'f':  PUTC(c, '\f'); break;
-                                        case 'n':  PUTC(c, '\n'); break;
-                                        case 'r':  PUTC(c, '\r'); break;
-                                        case 't':  PUTC(c, '\t'); break;
-                                        default:
-                                                c->top = head;
-                                                return XJSON_PARSE_INVALID_STRING_ESCAPE;
-                                }
-                                break;
-                        case '\0':
-                                c->top = head;
-                                return XJSON_PARSE_MISS_QUOTATION_MARK;
-                        default:
-                                if ((unsigned char)ch < 0x20) {
-                                        c->top = head;
-                                        return XJSON_PARSE_INVALID_STRING_CHAR;
-                                }
-                                PUTC(c, ch);
+static const char *
+xjson_scan_string_scalar(const char *p, const char *end, int *ascii) {
+        uint64_t high = 0;
+
+        for (; end - p >= 8; p += 8) {
+                uint64_t x;
+                memcpy(&x, p, sizeof(x));
+                if (SWAR_HAS_LESS(x, 0x20) | SWAR_HAS_BYTE(x, '\"') | SWAR_HAS_BYTE(x, '\\')) {
+                        break;
                 }
+                high |= x & (SWAR_ONES * 0x80);
         }
-}
-
-static int xjson_parse_array(xjson_context *c, xjson_value *v);
 
-/*---------------------------------------------------------------------------*
-        函数名: xjson_parse_value
-        描述:   json token解析函数
+        while (p < end && *p != '\"' && *p != '\\' && (unsigned char)*p >= 0x20) {
+                high |= *p++ & 0x80;
+        }
 
-        input:  c,              json会话
-                v,              json对象，用于存储json解析结果
+        if (high != 0) *ascii = xjson_false;
+        return p;
+}
 
-        output: v               json解析结果
+/*---------------------------------------------------------------------------*
+        函数名: xjson_validate_utf8_scalar
+        描述:   校验一段字符串是否为合法的UTF-8编码，逐字符校验
 
-        return: success, XJSON_PARSE_OK
-                failure, XJSON_PARSE_INVALID_VALUE ||
-                         XJSON_PARSE_EXPECT_VALUE ||
+        input:  p,              起始位置
+                end,            结束位置
 
-                         XJSON_PARSE_NUMBER_TOO_BIG ||
+        output: None
 
-                         XJSON_PARSE_INVALID_STRING_ESCAPE ||
-                         XJSON_PARSE_INVALID_STRING_CHAR ||
-                         XJSON_PARSE_MISS_QUOTATION_MARK
+        return: 合法, xjson_true
+                非法, xjson_false
  *---------------------------------------------------------------------------*/
 static int
-xjson_parse_value(xjson_context *c, xjson_value *v) {
+xjson_validate_utf8_scalar(const char *p, const char *end) {
+        const unsigned char *s = (const unsigned char *)p, *e = (const unsigned char *)end;
 
-        switch (*c->json) {
-                case 't':       return xjson_parse_literal(c, v, "true", XJSON_TRUE);
-                case 'f':       return xjson_parse_literal(c, v, "false", XJSON_FALSE);
-                case 'n':       return xjson_parse_literal(c, v, "null", XJSON_NULL);
-                case '"':       return xjson_parse_string(c, v);
-                case '[':       return xjson_parse_array(c, v);
-                default:        return xjson_parse_number(c, v);
-                case '\0':      return XJSON_PARSE_EXPECT_VALUE;
+        while (s < e) {
+                unsigned char ch = *s;
+                size_t n;
+
+                if (ch < 0x80) {
+                        s++;
+                        continue;
+                }
+
+                if (ch >= 0xc2 && ch <= 0xdf) n = 1;
+                else if (ch >= 0xe0 && ch <= 0xef) n = 2;
+                else if (ch >= 0xf0 && ch <= 0xf4) n = 3;
+                else return xjson_false;
+
+                if ((size_t)(e - s) <= n) {
+                        return xjson_false;
+                }
+
+                /* 第二个字节的范围排除过长编码、代理项和超过U+10FFFF的码点 */
+                if ((ch == 0xe0 && s[1] < 0xa0) ||
+                    (ch == 0xed && s[1] > 0x9f) ||
+                    (ch == 0xf0 && s[1] < 0x90) ||
+                    (ch == 0xf4 && s[1] > 0x8f)) {
+                        return xjson_false;
+                }
+
+                for (s++; n > 0; n--, s++) {
+                        if ((*s & 0xc0) != 0x80) {
+                                return xjson_false;
+                        }
+                }
         }
+
+        return xjson_true;
 }
 
+#ifdef XJSON_X86_DISPATCH
 /*---------------------------------------------------------------------------*
-        函数名: xjson_parse_array
-        描述:   解析array类型
+        函数名: xjson_skip_whitespace_sse42
+        描述:   同xjson_skip_whitespace_scalar，以pcmpestri每次比较16字节。
+                空白通常很短，前两个字节不都是空白时不进入向量循环
 
-        input:  c,              json会话
-                v,              json对象，用于存储json解析结果
+        input:  p,              起始位置
+                end,            json字符串结尾
 
-        output: v               json解析结果
+        output: None
 
-        return: success, XJSON_PARSE_OK
-                failure, XJSON_PARSE_INVALID_VALUE ||
-                         XJSON_PARSE_EXPECT_VALUE ||
+        return: 第一个非空白字符的位置，不存在时返回end
+ *---------------------------------------------------------------------------*/
+__attribute__((target("sse4.2"))) static const char *
+xjson_skip_whitespace_sse42(const char *p, const char *end) {
+        if (end - p < 2 || !ISWHITESPACE(p[0]) || !ISWHITESPACE(p[1])) {
+                return xjson_skip_whitespace_scalar(p, end);
+        }
 
-                         XJSON_PARSE_NUMBER_TOO_BIG ||
+        /* 显式长度，json中的'\0'不会提前结束比较 */
+        const __m128i ws = _mm_setr_epi8(' ', '\n', '\t', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
 
-                         XJSON_PARSE_INVALID_STRING_ESCAPE ||
-                         XJSON_PARSE_INVALID_STRING_CHAR ||
-                         XJSON_PARSE_MISS_QUOTATION_MARK ||
+        for (; end - p >= 16; p += 16) {
+                __m128i x = _mm_loadu_si128((const __m128i *)p);
+                int i = _mm_cmpestri(ws, 4, x, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY |
+                        _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT);
+                if (i < 16) {
+                        return p + i;
+                }
+        }
 
-                         XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET
- *---------------------------------------------------------------------------*/
-static int
-xjson_parse_array(xjson_context *c, xjson_value *v) {
-        EXPECT(c, '[');
+        return xjson_skip_whitespace_scalar(p, end);
+}
 
-        size_t size = 0;
-        int ret;
-        xjson_parse_whitespace(c);
-        if(*c->json == ']') {
-                c->json++;
-                v->type = XJSON_ARRAY;
-                v->u.a.size = 0;
-                v->u.a.e = NULL;
+/*---------------------------------------------------------------------------*
+        函数名: xjson_scan_string_sse42
+        描述:   同xjson_scan_string_scalar，以pcmpestri按范围每次比较16字节
 
-                return XJSON_PARSE_OK;
-        }
+        input:  p,              扫描起始位置
+                end,            json字符串结尾
+                ascii,          跳过的字符是否均为ASCII
 
-        for (;;) {
-                xjson_value e;
-                xjson_init(&e);
+        output: ascii           同xjson_scan_string_scalar
 
-                if ((ret = xjson_parse_value(c, &e)) != XJSON_PARSE_OK) {
-                        break;
+        return: 同xjson_scan_string_scalar
+ *---------------------------------------------------------------------------*/
+__attribute__((target("sse4.2"))) static const char *
+xjson_scan_string_sse42(const char *p, const char *end, int *ascii) {
+        /* 控制字符、'"'与'\\'三个范围 */
+        const __m128i stop = _mm_setr_epi8(0x00, 0x1f, '\"', '\"', '\\', '\\', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        int high = 0;
+
+        for (; end - p >= 16; p += 16) {
+                __m128i x = _mm_loadu_si128((const __m128i *)p);
+                int i = _mm_cmpestri(stop, 6, x, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+                high |= _mm_movemask_epi8(x);
+                if (i < 16) {
+                        if (high != 0) *ascii = xjson_false;
+                        return p + i;
                 }
+        }
 
-                memcpy(xjson_context_push(c, sizeof(xjson_value)), &e, sizeof(xjson_value));
-                size++;
+        if (high != 0) *ascii = xjson_false;
+        return xjson_scan_string_scalar(p, end, ascii);
+}
 
-                xjson_parse_whitespace(c);
-                if (*c->json == ',') {
-                        c->json++;
-                        xjson_parse_whitespace(c);
+/*---------------------------------------------------------------------------*
+        函数名: xjson_skip_whitespace_avx2
+        描述:   同xjson_skip_whitespace_scalar，每次比较32字节。空白通常
+                很短，前两个字节不都是空白时不进入向量循环
 
-                } else if (*c->json == ']') {
-                        c->json++;
-                        v->type = XJSON_ARRAY;
-                        v->u.a.size = size;
-                        size *= sizeof(xjson_value);
+        input:  p,              起始位置
+                end,            json字符串结尾
 
-                        memcpy(v->u.a.e = (xjson_value *)malloc(size), xjson_context_pop(c, size), size);
-                        return XJSON_PARSE_OK;
+        output: None
 
-                } else {
-                        ret =  XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
-                        break;
-                }
+        return: 第一个非空白字符的位置，不存在时返回end
+ *---------------------------------------------------------------------------*/
+__attribute__((target("avx2"))) static const char *
+xjson_skip_whitespace_avx2(const char *p, const char *end) {
+        if (end - p < 2 || !ISWHITESPACE(p[0]) || !ISWHITESPACE(p[1])) {
+                return xjson_skip_whitespace_scalar(p, end);
         }
 
-        for (int i = 0; i < size; i++) {
-                xjson_free((xjson_value*)xjson_context_pop(c, sizeof(xjson_value)));
+        const __m256i sp  = _mm256_set1_epi8(' ');
+        const __m256i nl  = _mm256_set1_epi8('\n');
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i cr  = _mm256_set1_epi8('\r');
+
+        for (; end - p >= 32; p += 32) {
+                __m256i x = _mm256_loadu_si256((const __m256i *)p);
+                __m256i m = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(x, sp), _mm256_cmpeq_epi8(x, nl)),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(x, tab), _mm256_cmpeq_epi8(x, cr)));
+                unsigned mask = ~(unsigned)_mm256_movemask_epi8(m);
+                if (mask != 0) {
+                        return p + __builtin_ctz(mask);
+                }
         }
 
-        return ret;
+        return xjson_skip_whitespace_scalar(p, end);
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_parse
-        描述:   json字符串解析函数
+        函数名: xjson_scan_string_avx2
+        描述:   同xjson_scan_string_scalar，每次比较32字节
 
-        input:  v,              json对象，用于存储json解析结果
-                json,           json字符串
+        input:  p,              扫描起始位置
+                end,            json字符串结尾
+                ascii,          跳过的字符是否均为ASCII
 
-        output: v               json解析结果
+        output: ascii           同xjson_scan_string_scalar
 
-        return: success, XJSON_PARSE_OK
-                failure, XJSON_PARSE_INVALID_VALUE ||
-                         XJSON_PARSE_EXPECT_VALUE ||
-                         XJSON_PARSE_ROOT_NOT_SINGULAR || 
+        return: 同xjson_scan_string_scalar
+ *---------------------------------------------------------------------------*/
+__attribute__((target("avx2"))) static const char *
+xjson_scan_string_avx2(const char *p, const char *end, int *ascii) {
+        const __m256i quote = _mm256_set1_epi8('\"');
+        const __m256i slash = _mm256_set1_epi8('\\');
+        const __m256i ctrl  = _mm256_set1_epi8(0x1f);
+        int high = 0;
+
+        for (; end - p >= 32; p += 32) {
+                __m256i x = _mm256_loadu_si256((const __m256i *)p);
+                __m256i m = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, slash)),
+                        _mm256_cmpeq_epi8(_mm256_min_epu8(x, ctrl), x));
+                unsigned mask = (unsigned)_mm256_movemask_epi8(m);
+                high |= _mm256_movemask_epi8(x);
+                if (mask != 0) {
+                        if (high != 0) *ascii = xjson_false;
+                        return p + __builtin_ctz(mask);
+                }
+        }
 
-                         XJSON_PARSE_NUMBER_TOO_BIG ||
+        if (high != 0) *ascii = xjson_false;
+        return xjson_scan_string_scalar(p, end, ascii);
+}
 
-                         XJSON_PARSE_INVALID_STRING_ESCAPE ||
-                         XJSON_PARSE_INVALID_STRING_CHAR ||
-                         XJSON_PARSE_MISS_QUOTATION_MARK
+/*---------------------------------------------------------------------------*
+        函数名: xjson_skip_whitespace_avx512
+        描述:   同xjson_skip_whitespace_avx2，每次比较64字节
+
+        input:  p,              起始位置
+                end,            json字符串结尾
+
+        output: None
+
+        return: 第一个非空白字符的位置，不存在时返回end
+ *---------------------------------------------------------------------------*/
+__attribute__((target("avx512f,avx512bw"))) static const char *
+xjson_skip_whitespace_avx512(const char *p, const char *end) {
+        if (end - p < 2 || !ISWHITESPACE(p[0]) || !ISWHITESPACE(p[1])) {
+                return xjson_skip_whitespace_scalar(p, end);
+        }
+
+        const __m512i sp  = _mm512_set1_epi8(' ');
+        const __m512i nl  = _mm512_set1_epi8('\n');
+        const __m512i tab = _mm512_set1_epi8('\t');
+        const __m512i cr  = _mm512_set1_epi8('\r');
+
+        for (; end - p >= 64; p += 64) {
+                __m512i x = _mm512_loadu_si512((const void *)p);
+                uint64_t mask = ~(uint64_t)(_mm512_cmpeq_epi8_mask(x, sp) | _mm512_cmpeq_epi8_mask(x, nl) |
+                        _mm512_cmpeq_epi8_mask(x, tab) | _mm512_cmpeq_epi8_mask(x, cr));
+                if (mask != 0) {
+                        return p + __builtin_ctzll(mask);
+                }
+        }
+
+        return xjson_skip_whitespace_scalar(p, end);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_scan_string_avx512
+        描述:   同xjson_scan_string_scalar，每次比较64字节
+
+        input:  p,              扫描起始位置
+                end,            json字符串结尾
+                ascii,          跳过的字符是否均为ASCII
+
+        output: ascii           同xjson_scan_string_scalar
+
+        return: 同xjson_scan_string_scalar
+ *---------------------------------------------------------------------------*/
+__attribute__((target("avx512f,avx512bw"))) static const char *
+xjson_scan_string_avx512(const char *p, const char *end, int *ascii) {
+        const __m512i quote = _mm512_set1_epi8('\"');
+        const __m512i slash = _mm512_set1_epi8('\\');
+        const __m512i ctrl  = _mm512_set1_epi8(0x1f);
+        uint64_t high = 0;
+
+        for (; end - p >= 64; p += 64) {
+                __m512i x = _mm512_loadu_si512((const void *)p);
+                uint64_t mask = _mm512_cmpeq_epi8_mask(x, quote) | _mm512_cmpeq_epi8_mask(x, slash) |
+                        _mm512_cmple_epu8_mask(x, ctrl);
+                high |= _mm512_movepi8_mask(x);
+                if (mask != 0) {
+                        if (high != 0) *ascii = xjson_false;
+                        return p + __builtin_ctzll(mask);
+                }
+        }
+
+        if (high != 0) *ascii = xjson_false;
+        return xjson_scan_string_scalar(p, end, ascii);
+}
+
+/* Keiser-Lemire查表法中用到的错误位，见"Validating UTF-8 In Less Than One Instruction Per Byte" */
+#define UTF8_TOO_SHORT          (1 << 0)
+#define UTF8_TOO_LONG           (1 << 1)
+#define UTF8_OVERLONG_3         (1 << 2)
+#define UTF8_TOO_LARGE          (1 << 3)
+#define UTF8_SURROGATE          (1 << 4)
+#define UTF8_OVERLONG_2         (1 << 5)
+#define UTF8_TOO_LARGE_1000     (1 << 6)
+#define UTF8_OVERLONG_4         (1 << 6)
+#define UTF8_TWO_CONTS          (1 << 7)
+#define UTF8_CARRY              (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_validate_utf8_ssse3
+        描述:   同xjson_validate_utf8_scalar，使用Keiser-Lemire查表法每次
+                校验16字节
+
+        input:  p,              起始位置
+                end,            结束位置
+
+        output: None
+
+        return: 合法, xjson_true
+                非法, xjson_false
+ *---------------------------------------------------------------------------*/
+__attribute__((target("ssse3"))) static int
+xjson_validate_utf8_ssse3(const char *p, const char *end) {
+        /* 第一个字节的高4位 */
+        const __m128i byte_1_high = _mm_setr_epi8(
+                UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+                UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+                UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+                UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+                UTF8_TOO_SHORT,
+                UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+                UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4);
+        /* 第一个字节的低4位 */
+        const __m128i byte_1_low = _mm_setr_epi8(
+                UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+                UTF8_CARRY | UTF8_OVERLONG_2,
+                UTF8_CARRY,
+                UTF8_CARRY,
+                UTF8_CARRY | UTF8_TOO_LARGE,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+                UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000);
+        /* 第二个字节的高4位 */
+        const __m128i byte_2_high = _mm_setr_epi8(
+                UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+                UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+                UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+                UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+                UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+                UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+                UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+        /* 块末尾仍需后续字节的位置 */
+        const __m128i incomplete_max = _mm_setr_epi8(
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                (char)0xef, (char)0xdf, (char)0xbf);
+        const __m128i nibble = _mm_set1_epi8(0x0f);
+        __m128i prev = _mm_setzero_si128();
+        __m128i error = _mm_setzero_si128();
+        __m128i incomplete = _mm_setzero_si128();
+        char tail[16];
+
+        while (p < end) {
+                __m128i in;
+                if (end - p >= 16) {
+                        in = _mm_loadu_si128((const __m128i *)p);
+                        p += 16;
+                } else {
+                        /* 不足16字节时以'\0'补齐，'\0'为ASCII，不影响结果 */
+                        memset(tail, 0, sizeof(tail));
+                        memcpy(tail, p, end - p);
+                        in = _mm_loadu_si128((const __m128i *)tail);
+                        p = end;
+                }
+
+                if (_mm_movemask_epi8(in) == 0) {
+                        error = _mm_or_si128(error, incomplete);
+                        incomplete = _mm_setzero_si128();
+                        prev = in;
+                        continue;
+                }
+
+                __m128i prev1 = _mm_alignr_epi8(in, prev, 15);
+                __m128i sc = _mm_and_si128(
+                        _mm_and_si128(
+                                _mm_shuffle_epi8(byte_1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                                _mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, nibble))),
+                        _mm_shuffle_epi8(byte_2_high, _mm_and_si128(_mm_srli_epi16(in, 4), nibble)));
+
+                /* 前两个字节为3/4字节序列首字节时，当前字节必须为后续字节 */
+                __m128i prev2 = _mm_alignr_epi8(in, prev, 14);
+                __m128i prev3 = _mm_alignr_epi8(in, prev, 13);
+                __m128i must23 = _mm_or_si128(
+                        _mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+                        _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xf0 - 0x80))));
+                must23 = _mm_and_si128(must23, _mm_set1_epi8((char)0x80));
+
+                error = _mm_or_si128(error, _mm_xor_si128(must23, sc));
+                incomplete = _mm_subs_epu8(in, incomplete_max);
+                prev = in;
+        }
+
+        error = _mm_or_si128(error, incomplete);
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff;
+}
+#endif
+
+/* 各级SIMD实现，下标为xjson_kernel */
+typedef struct {
+        const char *name;
+        const char *(*skip_whitespace)(const char *p, const char *end);
+        const char *(*scan_string)(const char *p, const char *end, int *ascii);
+        int (*validate_utf8)(const char *p, const char *end);
+}xjson_kernels;
+
+/* UTF-8校验受限于查表宽度，AVX2与AVX-512级别沿用SSSE3实现 */
+static const xjson_kernels xjson_kernel_table[XJSON_KERNEL_COUNT] = {
+        { "scalar", xjson_skip_whitespace_scalar, xjson_scan_string_scalar, xjson_validate_utf8_scalar },
+#ifdef XJSON_X86_DISPATCH
+        { "sse4.2", xjson_skip_whitespace_sse42, xjson_scan_string_sse42, xjson_validate_utf8_ssse3 },
+        { "avx2", xjson_skip_whitespace_avx2, xjson_scan_string_avx2, xjson_validate_utf8_ssse3 },
+        { "avx512", xjson_skip_whitespace_avx512, xjson_scan_string_avx512, xjson_validate_utf8_ssse3 },
+#else
+        { "sse4.2", xjson_skip_whitespace_scalar, xjson_scan_string_scalar, xjson_validate_utf8_scalar },
+        { "avx2", xjson_skip_whitespace_scalar, xjson_scan_string_scalar, xjson_validate_utf8_scalar },
+        { "avx512", xjson_skip_whitespace_scalar, xjson_scan_string_scalar, xjson_validate_utf8_scalar },
+#endif
+};
+
+/* 当前使用的SIMD实现，-1表示尚未检测 */
+static atomic_int xjson_active_kernel = -1;
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_kernel_supported
+        描述:   判断当前CPU能否运行指定级别的SIMD实现
+
+        input:  k,              SIMD实现
+
+        output: None
+
+        return: 支持, xjson_true
+                不支持, xjson_false
+ *---------------------------------------------------------------------------*/
+static int
+xjson_kernel_supported(xjson_kernel k) {
+#ifdef XJSON_X86_DISPATCH
+        __builtin_cpu_init();
+        switch (k) {
+                case XJSON_KERNEL_SCALAR:
+                        return xjson_true;
+                case XJSON_KERNEL_SSE42:
+                        return __builtin_cpu_supports("sse4.2") != 0;
+                case XJSON_KERNEL_AVX2:
+                        return __builtin_cpu_supports("avx2") != 0;
+                case XJSON_KERNEL_AVX512:
+                        return __builtin_cpu_supports("avx512bw") != 0;
+                default:
+                        return xjson_false;
+        }
+#else
+        return k == XJSON_KERNEL_SCALAR;
+#endif
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_kernel_detect
+        描述:   选择SIMD实现。环境变量XJSON_KERNEL指定的实现可用时使用它，
+                否则使用当前CPU支持的最高级别
+
+        input:  None
+
+        output: None
+
+        return: SIMD实现
+ *---------------------------------------------------------------------------*/
+static xjson_kernel
+xjson_kernel_detect(void) {
+        const char *name = getenv("XJSON_KERNEL");
+        int k;
+
+        if (name != NULL) {
+                for (k = 0; k < XJSON_KERNEL_COUNT; k++) {
+                        if (strcmp(name, xjson_kernel_table[k].name) == 0 && xjson_kernel_supported(k)) {
+                                return k;
+                        }
+                }
+        }
+
+        for (k = XJSON_KERNEL_COUNT - 1; k > XJSON_KERNEL_SCALAR; k--) {
+                if (xjson_kernel_supported(k)) {
+                        break;
+                }
+        }
+
+        return k;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_kernel
+        描述:   获取当前使用的SIMD实现，首次调用时检测CPU
+
+        input:  None
+
+        output: None
+
+        return: SIMD实现
+ *---------------------------------------------------------------------------*/
+xjson_kernel
+xjson_get_kernel(void) {
+        int k = atomic_load_explicit(&xjson_active_kernel, memory_order_relaxed);
+
+        if (k < 0) {
+                /* 并发的首次调用得到相同的结果，重复检测无害 */
+                k = xjson_kernel_detect();
+                atomic_store_explicit(&xjson_active_kernel, k, memory_order_relaxed);
+        }
+
+        return k;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_kernel
+        描述:   指定使用的SIMD实现，用于测试与对比。不应与解析并发调用
+
+        input:  k,              SIMD实现，XJSON_KERNEL_AUTO表示重新检测
+
+        output: None
+
+        return: success, xjson_true
+                failure, 当前CPU不支持时返回xjson_false，保持原实现
  *---------------------------------------------------------------------------*/
 int
-xjson_parse(xjson_value *v, const char *json) {
-        assert(v != NULL);
+xjson_set_kernel(xjson_kernel k) {
+        if (k == XJSON_KERNEL_AUTO) {
+                k = xjson_kernel_detect();
+        } else if (k < XJSON_KERNEL_SCALAR || k >= XJSON_KERNEL_COUNT || !xjson_kernel_supported(k)) {
+                return xjson_false;
+        }
+
+        atomic_store_explicit(&xjson_active_kernel, k, memory_order_relaxed);
+        return xjson_true;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_kernel_name
+        描述:   获取SIMD实现的名称，即环境变量XJSON_KERNEL的取值
+
+        input:  k,              SIMD实现
+
+        output: None
+
+        return: success, 名称
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+const char *
+xjson_get_kernel_name(xjson_kernel k) {
+        assert(k >= XJSON_KERNEL_SCALAR && k < XJSON_KERNEL_COUNT);
+
+        return xjson_kernel_table[k].name;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_context_whitespace
+        描述:   读取并丢弃json字符串中的空白字符
+
+        input:  c,              json会话
+
+        output: c->json,        指向json字符串中第一个非空白字符
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_parse_whitespace(xjson_context *c) {
+        /* 紧凑的json中多数位置没有空白，不必经过函数指针 */
+        if (c->json < c->end && ISWHITESPACE(*c->json)) {
+                c->json = xjson_kernel_table[xjson_get_kernel()].skip_whitespace(c->json, c->end);
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_scan_string
+        描述:   跳过字符串中无需特殊处理的字符，使用当前的SIMD实现
+
+        input:  p,              扫描起始位置
+                end,            json字符串结尾
+                ascii,          跳过的字符是否均为ASCII
+
+        output: ascii           跳过的字符中出现非ASCII字节时置为xjson_false，
+                                否则保持不变
+
+        return: 第一个'"'、'\\'或控制字符的位置，不存在时返回end
+ *---------------------------------------------------------------------------*/
+static const char *
+xjson_scan_string(const char *p, const char *end, int *ascii) {
+        return xjson_kernel_table[xjson_get_kernel()].scan_string(p, end, ascii);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_validate_utf8
+        描述:   校验一段字符串是否为合法的UTF-8编码，使用当前的SIMD实现
+
+        input:  p,              起始位置
+                end,            结束位置
+
+        output: None
+
+        return: 合法, xjson_true
+                非法, xjson_false
+ *---------------------------------------------------------------------------*/
+static int
+xjson_validate_utf8(const char *p, const char *end) {
+        return xjson_kernel_table[xjson_get_kernel()].validate_utf8(p, end);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_scan_number
+        描述:   校验number格式
+
+        input:  p,              number起始位置
+                end,            json字符串结尾
+
+        output: None
+
+        return: success, number结束位置
+                failure, NULL
+ *---------------------------------------------------------------------------*/
+static const char *
+xjson_scan_number(const char *p, const char *end) {
+        if (CHAR_AT(p, end) == '-') p++;
+        if (CHAR_AT(p, end) == '0') p++;
+        else {
+                if (!ISDIGITNZ(CHAR_AT(p, end))) return NULL;
+                for (p++; ISDIGIT(CHAR_AT(p, end)); p++);
+        }
+
+        if (CHAR_AT(p, end) == '.') {
+                p++;
+                if (!ISDIGIT(CHAR_AT(p, end))) return NULL;
+                for (p++; ISDIGIT(CHAR_AT(p, end)); p++);
+        }
+
+        if (CHAR_AT(p, end) == 'e' || CHAR_AT(p, end) == 'E') {
+                p++;
+                if (CHAR_AT(p, end) == '+' || CHAR_AT(p, end) == '-') p++;
+                if (!ISDIGIT(CHAR_AT(p, end))) return NULL;
+                for (p++; ISDIGIT(CHAR_AT(p, end)); p++);
+        }
+
+        return p;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_number_too_big
+        描述:   不做浮点转换，判断number转换为double后是否溢出
+
+        input:  p,              number起始位置，须已通过xjson_scan_number校验
+                end,            number结束位置
+
+        output: None
+
+        return: 溢出, xjson_true
+                未溢出, xjson_false
+ *---------------------------------------------------------------------------*/
+static int
+xjson_number_too_big(const char *p, const char *end) {
+        const char *digit, *d = xjson_overflow_digits;
+        long exp10, e = 0;
+        int negative = 0;
+
+        if (*p == '-') p++;
+
+        /* 数值记为0.d1d2d3...*10^exp10，先定位第一个有效数字d1 */
+        for (digit = p; p < end && ISDIGIT(*p); p++);
+        exp10 = (long)(p - digit);
+        if (*digit == '0') {
+                exp10 = 0;
+                if (p < end && *p == '.') {
+                        for (p++; p < end && *p == '0'; p++) {
+                                exp10--;
+                        }
+                }
+                if (p == end || !ISDIGIT(*p)) {
+                        return xjson_false;
+                }
+                digit = p;
+        }
+
+        for (p = digit; p < end && *p != 'e' && *p != 'E'; p++);
+        if (p < end) {
+                p++;
+                if (*p == '+' || *p == '-') {
+                        negative = *p++ == '-';
+                }
+                for (; p < end && e < 100000000L; p++) {
+                        e = e * 10 + (*p - '0');
+                }
+        }
+        exp10 += negative ? -e : e;
+
+        if (exp10 != 309) {
+                return exp10 > 309;
+        }
+
+        /* 数量级相同，逐位比较有效数字 */
+        for (p = digit; p < end && *p != 'e' && *p != 'E'; p++) {
+                if (*p == '.') {
+                        continue;
+                }
+                if (*d == '\0') {
+                        return xjson_true;
+                }
+                if (*p != *d) {
+                        return *p > *d;
+                }
+                d++;
+        }
+
+        return *d == '\0';
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_literal
+        描述:   解析boolean和null类型
+
+        input:  c,              json会话
+                v,              json对象，用于存储json解析结果
+                literal,        指定解析内容，可以为“true”、“false”或“null”
+                type,           指定解析类型，可以为XJSON_{TRUE|FALSE|NULL}
+
+        output: v.type          json解析结果, 可以为XJSON_{TRUE|FALSE|NULL}
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_INVALID_VALUE
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_literal(
+                xjson_context *c,
+                xjson_value *v,
+                const char *literal,
+                xjson_type type) {
+
+        EXPECT(c, literal[0]);
         
-        xjson_context c;
-        c.json = json;
-        c.stack = NULL;
-        c.size = c.top = 0;
+        size_t i;
+        for (i = 0; literal[i+1]; i++) {
+                if (c->json + i >= c->end || c->json[i] != literal[i+1]) {
+                        return XJSON_PARSE_INVALID_VALUE;
+                }
+        }
+
+        c->json += i;
+        v->type = type;
+
+        return XJSON_PARSE_OK;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_number
+        描述:   解析number类型
+
+        input:  c,              json会话
+                v,              json对象，用于存储json解析结果
+
+        output: v.type          json解析结果, 应为XJSON_NUMBER
+                v.n             json解析结果，存储双精度浮点型数值；
+                                XJSON_PARSER_LAZY_NUMBERS时只记录原文
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_INVALID_VALUE ||
+                         XJSON_PARSE_NUMBER_TOO_BIG ||
+                         XJSON_PARSE_OUT_OF_MEMORY
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_number(xjson_context *c, xjson_value *v) {
+        const char *p = xjson_scan_number(c->json, c->end);
+        if (p == NULL) {
+                return XJSON_PARSE_INVALID_VALUE;
+        }
+
+        size_t len = p - c->json;
+        if (c->flags & XJSON_PARSER_LAZY_NUMBERS) {
+                if (xjson_number_too_big(c->json, p)) {
+                        return XJSON_PARSE_NUMBER_TOO_BIG;
+                }
+                v->u.n.number = NAN;
+                v->u.n.literal = c->json;
+                v->u.n.length = len;
+                c->json = p;
+                v->type = XJSON_NUMBER;
+
+                return XJSON_PARSE_OK;
+        }
+
+        errno = 0;
+        v->u.n.literal = NULL;
+        v->u.n.length = 0;
+        if (p[-1] == '0' && len == (size_t)(*c->json == '-') + 1) {
+                /* "0"或"-0"，strtod可能越过number继续读取"0x"或后续数字 */
+                v->u.n.number = *c->json == '-' ? -0.0 : 0.0;
+        } else if (p < c->end) {
+                v->u.n.number = strtod(c->json, NULL);
+        } else {
+                /* number位于输入末尾，复制到栈上补'\0'后再转换 */
+                char *s = (char *)xjson_context_push(c, len + 1);
+                if (s == NULL) {
+                        return XJSON_PARSE_OUT_OF_MEMORY;
+                }
+                memcpy(s, c->json, len);
+                s[len] = '\0';
+                v->u.n.number = strtod(s, NULL);
+                xjson_context_pop(c, len + 1);
+        }
+
+        if (errno == ERANGE && (v->u.n.number == HUGE_VAL || v->u.n.number == -HUGE_VAL))
+                return XJSON_PARSE_NUMBER_TOO_BIG;
+
+        c->json = p;
+        v->type = XJSON_NUMBER;
+
+        return XJSON_PARSE_OK;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_convert_number
+        描述:   将延迟转换的number原文转换为double，原文须已通过校验
+
+        input:  literal,        number原文，不以'\0'结尾
+                length,         原文长度
+
+        output: None
+
+        return: 双精度浮点型数值
+ *---------------------------------------------------------------------------*/
+static double
+xjson_convert_number(const char *literal, size_t length) {
+        char buf[64], *s = length < sizeof(buf) ? buf : (char *)malloc(length + 1);
+        double d;
+
+        memcpy(s, literal, length);
+        s[length] = '\0';
+        d = strtod(s, NULL);
+        if (s != buf) {
+                free(s);
+        }
+
+        return d;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_hex4
+        描述:   解析\\u之后的4位十六进制数
+
+        input:  p,              十六进制数起始位置
+                end,            json字符串结尾
+                u,              用于存储解析结果
+
+        output: u               解析得到的码元
+
+        return: success, 十六进制数之后的位置
+                failure, NULL
+ *---------------------------------------------------------------------------*/
+static const char *
+xjson_parse_hex4(const char *p, const char *end, unsigned *u) {
+        if (end - p < 4) {
+                return NULL;
+        }
+
+        *u = 0;
+        for (int i = 0; i < 4; i++) {
+                char ch = *p++;
+                *u <<= 4;
+                if      (ch >= '0' && ch <= '9') *u |= ch - '0';
+                else if (ch >= 'A' && ch <= 'F') *u |= ch - ('A' - 10);
+                else if (ch >= 'a' && ch <= 'f') *u |= ch - ('a' - 10);
+                else return NULL;
+        }
+
+        return p;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_unicode
+        描述:   解析\\uXXXX转义，高代理项须紧跟\\uXXXX形式的低代理项
+
+        input:  p,              指向'u'之后
+                end,            json字符串结尾
+                u,              用于存储解析结果
+
+        output: p               转义序列之后的位置
+                u               解析得到的码点
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_INVALID_UNICODE_HEX ||
+                         XJSON_PARSE_INVALID_UNICODE_SURROGATE
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_unicode(const char **p, const char *end, unsigned *u) {
+        unsigned low;
+        const char *q;
+
+        if ((q = xjson_parse_hex4(*p, end, u)) == NULL) {
+                return XJSON_PARSE_INVALID_UNICODE_HEX;
+        }
+
+        if (*u >= 0xdc00 && *u <= 0xdfff) {
+                return XJSON_PARSE_INVALID_UNICODE_SURROGATE;
+        }
+
+        if (*u >= 0xd800 && *u <= 0xdbff) {
+                if (CHAR_AT(q, end) != '\\' || CHAR_AT(q + 1, end) != 'u') {
+                        return XJSON_PARSE_INVALID_UNICODE_SURROGATE;
+                }
+                if ((q = xjson_parse_hex4(q + 2, end, &low)) == NULL) {
+                        return XJSON_PARSE_INVALID_UNICODE_HEX;
+                }
+                if (low < 0xdc00 || low > 0xdfff) {
+                        return XJSON_PARSE_INVALID_UNICODE_SURROGATE;
+                }
+                *u = 0x10000 + (((*u - 0xd800) << 10) | (low - 0xdc00));
+        }
+
+        *p = q;
+        return XJSON_PARSE_OK;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_utf8_length
+        描述:   计算码点UTF-8编码后的字节数
+
+        input:  u,              码点
+
+        output: None
+
+        return: 1 ~ 4
+ *---------------------------------------------------------------------------*/
+static size_t
+xjson_utf8_length(unsigned u) {
+        assert(u <= 0x10ffff);
+        return u <= 0x7f ? 1 : u <= 0x7ff ? 2 : u <= 0xffff ? 3 : 4;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_encode_utf8
+        描述:   将码点以UTF-8编码压入会话栈
+
+        input:  c,              json会话
+                u,              码点
+
+        output: None
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_OUT_OF_MEMORY
+ *---------------------------------------------------------------------------*/
+static int
+xjson_encode_utf8(xjson_context *c, unsigned u) {
+        size_t n = xjson_utf8_length(u);
+        unsigned char *s = (unsigned char *)xjson_context_push(c, n);
+
+        if (s == NULL) {
+                return XJSON_PARSE_OUT_OF_MEMORY;
+        }
+
+        switch (n) {
+                case 1:
+                        s[0] = u;
+                        break;
+                case 2:
+                        s[0] = 0xc0 | (u >> 6);
+                        s[1] = 0x80 | (u & 0x3f);
+                        break;
+                case 3:
+                        s[0] = 0xe0 | (u >> 12);
+                        s[1] = 0x80 | ((u >> 6) & 0x3f);
+                        s[2] = 0x80 | (u & 0x3f);
+                        break;
+                default:
+                        s[0] = 0xf0 | (u >> 18);
+                        s[1] = 0x80 | ((u >> 12) & 0x3f);
+                        s[2] = 0x80 | ((u >> 6) & 0x3f);
+                        s[3] = 0x80 | (u & 0x3f);
+                        break;
+        }
+        STAT_ADD(c, string_bytes_escaped, n);
+
+        return XJSON_PARSE_OK;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_string_raw
+        描述:   解析string类型，解码后的字符串留在会话栈顶，由调用者出栈
+
+        input:  c,              json会话
+                len,            用于存储字符串长度
+
+        output: len             解码后的字符串长度
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_INVALID_STRING_ESCAPE ||
+                         XJSON_PARSE_INVALID_STRING_CHAR ||
+                         XJSON_PARSE_INVALID_UTF8 ||
+                         XJSON_PARSE_INVALID_UNICODE_HEX ||
+                         XJSON_PARSE_INVALID_UNICODE_SURROGATE ||
+                         XJSON_PARSE_MISS_QUOTATION_MARK ||
+                         XJSON_PARSE_OUT_OF_MEMORY
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_string_raw(xjson_context *c, size_t *len) {
+        EXPECT(c, '\"');
+
+        size_t head = c->top;
+        const char *p = c->json, *q;
+        char *s, ch;
+        unsigned u;
+        int ret;
+        for (;;) {
+                int ascii = xjson_true;
+                q = xjson_scan_string(p, c->end, &ascii);
+                if (!ascii && !xjson_validate_utf8(p, q)) {
+                        c->top = head;
+                        return XJSON_PARSE_INVALID_UTF8;
+                }
+                if (q != p) {
+                        if ((s = (char *)xjson_context_push(c, q - p)) == NULL) {
+                                c->top = head;
+                                return XJSON_PARSE_OUT_OF_MEMORY;
+                        }
+                        memcpy(s, p, q - p);
+                        STAT_ADD(c, string_bytes_copied, q - p);
+                        p = q;
+                }
+
+                if (p == c->end) {
+                        c->top = head;
+                        return XJSON_PARSE_MISS_QUOTATION_MARK;
+                }
+
+                switch(*p++) {
+                        case '\"':
+                                *len = c->top - head;
+                                c->json = p;
+                                return XJSON_PARSE_OK;
+                        case '\\':
+                                switch (CHAR_AT(p, c->end)) {
+                                        case '\"': ch = '\"'; break;
+                                        case '\\': ch = '\\'; break;
+                                        case '/':  ch = '/' ; break;
+                                        case 'b':  ch = '\b'; break;
+                                        case 'f':  ch = '\f'; break;
+                                        case 'n':  ch = '\n'; break;
+                                        case 'r':  ch = '\r'; break;
+                                        case 't':  ch = '\t'; break;
+                                        case 'u':
+                                                p++;
+                                                if ((ret = xjson_parse_unicode(&p, c->end, &u)) != XJSON_PARSE_OK ||
+                                                    (ret = xjson_encode_utf8(c, u)) != XJSON_PARSE_OK) {
+                                                        c->top = head;
+                                                        return ret;
+                                                }
+                                                continue;
+                                        default:
+                                                c->top = head;
+                                                return XJSON_PARSE_INVALID_STRING_ESCAPE;
+                                }
+                                if ((s = (char *)xjson_context_push(c, 1)) == NULL) {
+                                        c->top = head;
+                                        return XJSON_PARSE_OUT_OF_MEMORY;
+                                }
+                                *s = ch;
+                                STAT_ADD(c, string_bytes_escaped, 1);
+                                p++;
+                                break;
+                        default:
+                                c->top = head;
+                                return XJSON_PARSE_INVALID_STRING_CHAR;
+                }
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_string
+        描述:   解析string类型
+
+        input:  c,              json会话
+                v,              json对象，用于存储json解析结果
+
+        output: v.type          json解析结果, 应为XJSON_STRING
+                v.u.s.string    json解析结果，存储字符串
+                v.u.s.length    json解析结果，存储字符串长度
+
+        return: 同xjson_parse_string_raw
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_string(xjson_context *c, xjson_value *v) {
+        size_t len;
+        const char *p;
+        char *s;
+        int ret;
+
+        if ((ret = xjson_parse_string_raw(c, &len)) != XJSON_PARSE_OK) {
+                return ret;
+        }
+
+        /* 先分配再出栈，静态缓冲区中结果区不会覆盖栈顶的字符串 */
+        if ((s = (char *)xjson_context_alloc(c, len + 1)) == NULL) {
+                xjson_context_pop(c, len);
+                return XJSON_PARSE_OUT_OF_MEMORY;
+        }
+
+        p = (const char *)xjson_context_pop(c, len);
+        if (len > 0) {
+                memcpy(s, p, len);
+        }
+        s[len] = '\0';
+        v->type = XJSON_STRING;
+        v->u.s.string = s;
+        v->u.s.length = len;
+
+        return XJSON_PARSE_OK;
+}
+
+static int xjson_parse_array(xjson_context *c, xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_value
+        描述:   json token解析函数
+
+        input:  c,              json会话
+                v,              json对象，用于存储json解析结果
+
+        output: v               json解析结果
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_INVALID_VALUE ||
+                         XJSON_PARSE_EXPECT_VALUE ||
+
+                         XJSON_PARSE_NUMBER_TOO_BIG ||
+
+                         XJSON_PARSE_INVALID_STRING_ESCAPE ||
+                         XJSON_PARSE_INVALID_STRING_CHAR ||
+                         XJSON_PARSE_INVALID_UTF8 ||
+                         XJSON_PARSE_INVALID_UNICODE_HEX ||
+                         XJSON_PARSE_INVALID_UNICODE_SURROGATE ||
+                         XJSON_PARSE_MISS_QUOTATION_MARK
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_value(xjson_context *c, xjson_value *v) {
+        int ret;
+        TIMER_BEGIN(t);
+
+        switch (PEEK(c)) {
+                case 't':
+                        ret = xjson_parse_literal(c, v, "true", XJSON_TRUE);
+                        TIMER_END(c, t, XJSON_PHASE_LITERAL);
+                        break;
+                case 'f':
+                        ret = xjson_parse_literal(c, v, "false", XJSON_FALSE);
+                        TIMER_END(c, t, XJSON_PHASE_LITERAL);
+                        break;
+                case 'n':
+                        ret = xjson_parse_literal(c, v, "null", XJSON_NULL);
+                        TIMER_END(c, t, XJSON_PHASE_LITERAL);
+                        break;
+                case '"':
+                        ret = xjson_parse_string(c, v);
+                        TIMER_END(c, t, XJSON_PHASE_STRING);
+                        break;
+                case '[':
+                        ret = xjson_parse_array(c, v);
+                        break;
+                default:
+                        ret = xjson_parse_number(c, v);
+                        TIMER_END(c, t, XJSON_PHASE_NUMBER);
+                        break;
+                case '\0':
+                        return XJSON_PARSE_EXPECT_VALUE;
+        }
+
+#ifdef XJSON_ENABLE_STATS
+        if (ret == XJSON_PARSE_OK) {
+                STAT_ADD(c, values[v->type], 1);
+        }
+#endif
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_array
+        描述:   解析array类型
+
+        input:  c,              json会话
+                v,              json对象，用于存储json解析结果
+
+        output: v               json解析结果
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_INVALID_VALUE ||
+                         XJSON_PARSE_EXPECT_VALUE ||
+
+                         XJSON_PARSE_NUMBER_TOO_BIG ||
+
+                         XJSON_PARSE_INVALID_STRING_ESCAPE ||
+                         XJSON_PARSE_INVALID_STRING_CHAR ||
+                         XJSON_PARSE_INVALID_UTF8 ||
+                         XJSON_PARSE_INVALID_UNICODE_HEX ||
+                         XJSON_PARSE_INVALID_UNICODE_SURROGATE ||
+                         XJSON_PARSE_MISS_QUOTATION_MARK ||
+
+                         XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_array(xjson_context *c, xjson_value *v) {
+        EXPECT(c, '[');
+
+        size_t size = 0;
+        int ret;
+#ifdef XJSON_ENABLE_STATS
+        c->depth++;
+        STAT_MAX(c, depth_max, c->depth);
+#endif
+        xjson_parse_whitespace(c);
+        if(PEEK(c) == ']') {
+                c->json++;
+                v->type = XJSON_ARRAY;
+                v->u.a.size = v->u.a.capacity = 0;
+                v->u.a.e = NULL;
+#ifdef XJSON_ENABLE_STATS
+                c->depth--;
+#endif
+
+                return XJSON_PARSE_OK;
+        }
+
+        for (;;) {
+                xjson_value e, *top;
+                xjson_init(&e);
+
+                if ((ret = xjson_parse_value(c, &e)) != XJSON_PARSE_OK) {
+                        break;
+                }
+
+                if ((top = (xjson_value *)xjson_context_push(c, sizeof(xjson_value))) == NULL) {
+                        xjson_context_release(c, &e);
+                        ret = XJSON_PARSE_OUT_OF_MEMORY;
+                        break;
+                }
+                memcpy(top, &e, sizeof(xjson_value));
+                size++;
+
+                xjson_parse_whitespace(c);
+                if (PEEK(c) == ',') {
+                        c->json++;
+                        xjson_parse_whitespace(c);
+
+                } else if (PEEK(c) == ']') {
+                        TIMER_BEGIN(t);
+                        xjson_value *elements = (xjson_value *)xjson_context_alloc(c, size * sizeof(xjson_value));
+                        if (elements == NULL) {
+                                ret = XJSON_PARSE_OUT_OF_MEMORY;
+                                break;
+                        }
+
+                        c->json++;
+                        v->type = XJSON_ARRAY;
+                        v->u.a.size = v->u.a.capacity = size;
+                        size *= sizeof(xjson_value);
+
+                        memcpy(v->u.a.e = elements, xjson_context_pop(c, size), size);
+                        TIMER_END(c, t, XJSON_PHASE_ARRAY);
+#ifdef XJSON_ENABLE_STATS
+                        c->depth--;
+#endif
+                        return XJSON_PARSE_OK;
+
+                } else {
+                        ret =  XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                        break;
+                }
+        }
+
+        for (int i = 0; i < size; i++) {
+                xjson_context_release(c, (xjson_value*)xjson_context_pop(c, sizeof(xjson_value)));
+        }
+#ifdef XJSON_ENABLE_STATS
+        c->depth--;
+#endif
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_validate_string
+        描述:   校验string类型，不复制字符串内容，只计算解码后的长度
+
+        input:  c,              json会话
+
+        output: c->json,        成功时指向string之后，失败时指向出错的字符
+                c->peak         静态解析所需的缓冲区峰值
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_INVALID_STRING_ESCAPE ||
+                         XJSON_PARSE_INVALID_STRING_CHAR ||
+                         XJSON_PARSE_INVALID_UTF8 ||
+                         XJSON_PARSE_INVALID_UNICODE_HEX ||
+                         XJSON_PARSE_INVALID_UNICODE_SURROGATE ||
+                         XJSON_PARSE_MISS_QUOTATION_MARK
+ *---------------------------------------------------------------------------*/
+static int
+xjson_validate_string(xjson_context *c) {
+        EXPECT(c, '\"');
+
+        const char *p = c->json, *q;
+        size_t len = 0;
+        unsigned u;
+        int ret;
+        for (;;) {
+                int ascii = xjson_true;
+                q = xjson_scan_string(p, c->end, &ascii);
+                if (!ascii && !xjson_validate_utf8(p, q)) {
+                        c->json = p;
+                        return XJSON_PARSE_INVALID_UTF8;
+                }
+
+                len += q - p;
+                p = q;
+                if (p == c->end) {
+                        c->json = p;
+                        return XJSON_PARSE_MISS_QUOTATION_MARK;
+                }
+
+                switch (*p) {
+                        case '\"':
+                                c->json = p + 1;
+                                xjson_context_measure(c, len, len + 1);
+                                return XJSON_PARSE_OK;
+                        case '\\':
+                                switch (CHAR_AT(p + 1, c->end)) {
+                                        case '\"': case '\\': case '/':
+                                        case 'b': case 'f': case 'n': case 'r': case 't':
+                                                len++;
+                                                p += 2;
+                                                break;
+                                        case 'u':
+                                                q = p + 2;
+                                                if ((ret = xjson_parse_unicode(&q, c->end, &u)) != XJSON_PARSE_OK) {
+                                                        c->json = p;
+                                                        return ret;
+                                                }
+                                                len += xjson_utf8_length(u);
+                                                p = q;
+                                                break;
+                                        default:
+                                                c->json = p;
+                                                return XJSON_PARSE_INVALID_STRING_ESCAPE;
+                                }
+                                break;
+                        default:
+                                c->json = p;
+                                return XJSON_PARSE_INVALID_STRING_CHAR;
+                }
+        }
+}
+
+static int xjson_validate_array(xjson_context *c);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_validate_value
+        描述:   json token校验函数，语法与xjson_parse_value一致，但不构建
+                json对象，不分配内存，也不使用会话栈。同时模拟静态解析的
+                压栈与分配，c->top为模拟的栈顶
+
+        input:  c,              json会话
+
+        output: c->json,        成功时指向token之后，失败时指向出错位置
+                c->peak         静态解析所需的缓冲区峰值
+
+        return: 同xjson_parse_value
+ *---------------------------------------------------------------------------*/
+static int
+xjson_validate_value(xjson_context *c) {
+        xjson_value literal;
+        const char *p;
+
+        switch (PEEK(c)) {
+                case 't':       return xjson_parse_literal(c, &literal, "true", XJSON_TRUE);
+                case 'f':       return xjson_parse_literal(c, &literal, "false", XJSON_FALSE);
+                case 'n':       return xjson_parse_literal(c, &literal, "null", XJSON_NULL);
+                case '"':       return xjson_validate_string(c);
+                case '[':       return xjson_validate_array(c);
+                case '\0':      return XJSON_PARSE_EXPECT_VALUE;
+                default:
+                        if ((p = xjson_scan_number(c->json, c->end)) == NULL) {
+                                return XJSON_PARSE_INVALID_VALUE;
+                        }
+                        if (xjson_number_too_big(c->json, p)) {
+                                return XJSON_PARSE_NUMBER_TOO_BIG;
+                        }
+                        if (p == c->end) {
+                                /* 同xjson_parse_number，复制到栈上补'\0' */
+                                xjson_context_measure(c, p - c->json + 1, 0);
+                        }
+                        c->json = p;
+                        return XJSON_PARSE_OK;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_validate_array
+        描述:   校验array类型
+
+        input:  c,              json会话
+
+        output: c->json,        成功时指向array之后，失败时指向出错位置
+
+        return: 同xjson_parse_array
+ *---------------------------------------------------------------------------*/
+static int
+xjson_validate_array(xjson_context *c) {
+        EXPECT(c, '[');
+
+        size_t size = 0;
+        int ret;
+        xjson_parse_whitespace(c);
+        if (PEEK(c) == ']') {
+                c->json++;
+                return XJSON_PARSE_OK;
+        }
+
+        for (;;) {
+                if ((ret = xjson_validate_value(c)) != XJSON_PARSE_OK) {
+                        return ret;
+                }
+
+                c->top += sizeof(xjson_value);
+                xjson_context_measure(c, 0, 0);
+                size++;
+
+                xjson_parse_whitespace(c);
+                if (PEEK(c) == ',') {
+                        c->json++;
+                        xjson_parse_whitespace(c);
+                } else if (PEEK(c) == ']') {
+                        c->json++;
+                        size *= sizeof(xjson_value);
+                        xjson_context_measure(c, 0, size);
+                        c->top -= size;
+                        return XJSON_PARSE_OK;
+                } else {
+                        return XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                }
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_root
+        描述:   解析完整的json字符串，根节点之后只允许空白字符
+
+        input:  c,              json会话
+                v,              json对象，用于存储json解析结果
+
+        output: v               json解析结果
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_root(xjson_context *c, xjson_value *v) {
+        xjson_init(v);
+        xjson_parse_whitespace(c);
+        int ret = xjson_parse_value(c, v);
+        if (ret == XJSON_PARSE_OK) {
+                xjson_parse_whitespace(c);
+                if (c->json != c->end) {
+                        xjson_context_release(c, v);
+                        ret = XJSON_PARSE_ROOT_NOT_SINGULAR;
+                }
+        }
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse
+        描述:   json字符串解析函数
+
+        input:  v,              json对象，用于存储json解析结果
+                json,           json字符串
+
+        output: v               json解析结果
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_INVALID_VALUE ||
+                         XJSON_PARSE_EXPECT_VALUE ||
+                         XJSON_PARSE_ROOT_NOT_SINGULAR || 
+
+                         XJSON_PARSE_NUMBER_TOO_BIG ||
+
+                         XJSON_PARSE_INVALID_STRING_ESCAPE ||
+                         XJSON_PARSE_INVALID_STRING_CHAR ||
+                         XJSON_PARSE_INVALID_UTF8 ||
+                         XJSON_PARSE_INVALID_UNICODE_HEX ||
+                         XJSON_PARSE_INVALID_UNICODE_SURROGATE ||
+                         XJSON_PARSE_MISS_QUOTATION_MARK
+ *---------------------------------------------------------------------------*/
+int
+xjson_parse(xjson_value *v, const char *json) {
+        assert(v != NULL && json != NULL);
+        
+        xjson_context c;
+        xjson_context_init(&c, json, strlen(json));
+
+        int ret = xjson_parse_root(&c, v);
+
+        assert(c.top == 0);
+        free(c.stack);
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parser_init
+        描述:   初始化可复用的json解析器
+
+        input:  p,              json解析器
+
+        output: p               空的json解析器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_parser_init(xjson_parser *p) {
+        assert(p != NULL);
+
+        p->stack = NULL;
+        p->size = 0;
+        p->flags = 0;
+        p->threads = 1;
+        p->arena.chunks = NULL;
+        p->arena.top = p->arena.end = NULL;
+        memset(&p->stats, 0, sizeof(p->stats));
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parser_free
+        描述:   释放json解析器，包括批量解析的全部结果
+
+        input:  p,              json解析器
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_parser_free(xjson_parser *p) {
+        assert(p != NULL);
+
+        free(p->stack);
+        xjson_arena_clear(&p->arena, xjson_false);
+        xjson_parser_init(p);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parser_parse
+        描述:   使用json解析器解析json字符串，会话栈在多次解析间复用，
+                开启XJSON_ENABLE_STATS时累计解析统计
+
+        input:  p,              json解析器
+                v,              json对象，用于存储json解析结果
+                json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+
+        output: v               json解析结果
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int
+xjson_parser_parse(xjson_parser *p, xjson_value *v, const char *json, size_t len) {
+        assert(p != NULL && v != NULL && (json != NULL || len == 0));
+
+        xjson_context c;
+        xjson_context_init(&c, json, len);
+        c.stack = p->stack;
+        c.size = p->size;
+        c.flags = p->flags;
+#ifdef XJSON_ENABLE_STATS
+        c.stats = &p->stats;
+#endif
+        TIMER_BEGIN(t);
+
+        int ret = xjson_parse_root(&c, v);
+
+        TIMER_END(&c, t, XJSON_PHASE_TOTAL);
+        STAT_ADD(&c, documents, 1);
+        STAT_SET(&c, kernel, xjson_get_kernel());
+        STAT_ADD(&c, bytes, c.json - json);
+        if (ret != XJSON_PARSE_OK) {
+                STAT_ADD(&c, errors, 1);
+        }
+
+        assert(c.top == 0);
+        p->stack = c.stack;
+        p->size = c.size;
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parser_get_stats
+        描述:   获取json解析器累计的解析统计，未开启XJSON_ENABLE_STATS时全为0
+
+        input:  p,              json解析器
+
+        output: None
+
+        return: success, 解析统计
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+const xjson_stats *
+xjson_parser_get_stats(const xjson_parser *p) {
+        assert(p != NULL);
+        return &p->stats;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parser_reset_stats
+        描述:   清零json解析器累计的解析统计
+
+        input:  p,              json解析器
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_parser_reset_stats(xjson_parser *p) {
+        assert(p != NULL);
+        memset(&p->stats, 0, sizeof(p->stats));
+}
+
+/* 批量解析中一段连续json的解析任务 */
+typedef struct {
+        const char *const       *docs;
+        const size_t            *lens;
+        xjson_value             *out;
+        int                     *status;
+        size_t                  n, ok;
+        unsigned                flags;
+        char                    *stack;
+        size_t                  size;
+        xjson_arena             arena;
+        xjson_stats             *stats;
+}xjson_batch;
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_prefetch
+        描述:   预取json字符串的前XJSON_PREFETCH_BYTES字节
+
+        input:  p,              json字符串
+                len,            json字符串长度
+
+        output: None
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_prefetch(const char *p, size_t len) {
+#ifdef __GNUC__
+        if (len > XJSON_PREFETCH_BYTES) {
+                len = XJSON_PREFETCH_BYTES;
+        }
+        for (size_t i = 0; i < len; i += 64) {
+                __builtin_prefetch(p + i);
+        }
+#else
+        (void)p;
+        (void)len;
+#endif
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_batch_run
+        描述:   依次解析一段json，所有json共用一个会话栈与结果区
+
+        input:  arg,            xjson_batch
+
+        output: arg             解析结果与复用后的会话栈、结果区
+
+        return: NULL
+ *---------------------------------------------------------------------------*/
+static void *
+xjson_batch_run(void *arg) {
+        xjson_batch *b = (xjson_batch *)arg;
+        xjson_context c;
+        int ret;
+
+        b->ok = 0;
+        for (size_t i = 0; i < b->n; i++) {
+                if (i + 1 < b->n) {
+                        xjson_prefetch(b->docs[i + 1], b->lens[i + 1]);
+                }
+
+                xjson_context_init(&c, b->docs[i], b->lens[i]);
+                c.stack = b->stack;
+                c.size = b->size;
+                c.flags = b->flags;
+                c.arena = &b->arena;
+#ifdef XJSON_ENABLE_STATS
+                c.stats = b->stats;
+#endif
+                TIMER_BEGIN(t);
+
+                ret = xjson_parse_root(&c, &b->out[i]);
+
+                TIMER_END(&c, t, XJSON_PHASE_TOTAL);
+                STAT_ADD(&c, documents, 1);
+                STAT_SET(&c, kernel, xjson_get_kernel());
+                STAT_ADD(&c, bytes, c.json - b->docs[i]);
+                if (ret != XJSON_PARSE_OK) {
+                        STAT_ADD(&c, errors, 1);
+                } else {
+                        b->ok++;
+                }
+                if (b->status != NULL) {
+                        b->status[i] = ret;
+                }
+
+                assert(c.top == 0);
+                b->stack = c.stack;
+                b->size = c.size;
+        }
+
+        return NULL;
+}
+
+#ifdef XJSON_ENABLE_THREADS
+#ifdef XJSON_ENABLE_STATS
+/*---------------------------------------------------------------------------*
+        函数名: xjson_stats_merge
+        描述:   将工作线程的解析统计合并至解析器
+
+        input:  dst,            解析器的解析统计
+                src,            工作线程的解析统计
+
+        output: dst             合并后的解析统计
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_stats_merge(xjson_stats *dst, const xjson_stats *src) {
+        dst->documents += src->documents;
+        dst->errors += src->errors;
+        dst->kernel = src->kernel;
+        dst->bytes += src->bytes;
+        for (int i = 0; i <= XJSON_OBJECT; i++) {
+                dst->values[i] += src->values[i];
+        }
+        dst->string_bytes_copied += src->string_bytes_copied;
+        dst->string_bytes_escaped += src->string_bytes_escaped;
+        dst->stack_reallocs += src->stack_reallocs;
+        dst->allocs += src->allocs;
+        dst->alloc_bytes += src->alloc_bytes;
+        if (dst->stack_peak < src->stack_peak) {
+                dst->stack_peak = src->stack_peak;
+        }
+        if (dst->depth_max < src->depth_max) {
+                dst->depth_max = src->depth_max;
+        }
+        for (int i = 0; i < XJSON_PHASE_COUNT; i++) {
+                dst->cycles[i] += src->cycles[i];
+        }
+}
+#endif
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_batch_threads
+        描述:   将json按个数均分为threads段并行解析，第一段在当前线程解析
+                并使用解析器的会话栈与结果区，其余段的结果区并入解析器
+
+        input:  b,              第一段之外字段均已设置的解析任务
+                p,              json解析器
+                threads,        线程数，不超过json个数
+
+        output: p               合并后的结果区与解析统计
+
+        return: 解析成功的json个数
+ *---------------------------------------------------------------------------*/
+static size_t
+xjson_parse_batch_threads(xjson_batch *b, xjson_parser *p, unsigned threads) {
+        xjson_batch *batch = (xjson_batch *)malloc(threads * sizeof(xjson_batch));
+        pthread_t *tid = (pthread_t *)malloc(threads * sizeof(pthread_t));
+        int *started = (int *)calloc(threads, sizeof(int));
+        size_t n = b->n, begin = 0, ok = 0;
+#ifdef XJSON_ENABLE_STATS
+        xjson_stats *stats = (xjson_stats *)calloc(threads, sizeof(xjson_stats));
+#endif
+
+        assert(batch != NULL && tid != NULL && started != NULL);
+        for (unsigned i = 0; i < threads; i++) {
+                size_t count = n / threads + (i < n % threads);
+
+                batch[i] = *b;
+                batch[i].docs += begin;
+                batch[i].lens += begin;
+                batch[i].out += begin;
+                batch[i].status = b->status ? b->status + begin : NULL;
+                batch[i].n = count;
+                begin += count;
+                if (i > 0) {
+                        batch[i].stack = NULL;
+                        batch[i].size = 0;
+                        batch[i].arena.chunks = NULL;
+                        batch[i].arena.top = batch[i].arena.end = NULL;
+#ifdef XJSON_ENABLE_STATS
+                        batch[i].stats = &stats[i];
+#endif
+                        started[i] = pthread_create(&tid[i], NULL, xjson_batch_run, &batch[i]) == 0;
+                }
+        }
+
+        /* 第一段及创建线程失败的段在当前线程解析 */
+        for (unsigned i = 0; i < threads; i++) {
+                if (!started[i]) {
+                        xjson_batch_run(&batch[i]);
+                }
+        }
+
+        for (unsigned i = 0; i < threads; i++) {
+                xjson_chunk *tail;
+
+                if (started[i]) {
+                        pthread_join(tid[i], NULL);
+                }
+                ok += batch[i].ok;
+                if (i == 0) {
+                        p->arena = batch[0].arena;
+                        continue;
+                }
+
+                free(batch[i].stack);
+#ifdef XJSON_ENABLE_STATS
+                xjson_stats_merge(&p->stats, &stats[i]);
+#endif
+                /* 其余段的内存块接在当前块之后，当前块保持不变 */
+                if ((tail = (xjson_chunk *)batch[i].arena.chunks) == NULL) {
+                        continue;
+                }
+                if (p->arena.chunks == NULL) {
+                        p->arena = batch[i].arena;
+                        continue;
+                }
+                while (tail->h.next != NULL) {
+                        tail = tail->h.next;
+                }
+                tail->h.next = ((xjson_chunk *)p->arena.chunks)->h.next;
+                ((xjson_chunk *)p->arena.chunks)->h.next = (xjson_chunk *)batch[i].arena.chunks;
+        }
+
+        p->stack = batch[0].stack;
+        p->size = batch[0].size;
+
+        free(batch);
+        free(tid);
+        free(started);
+#ifdef XJSON_ENABLE_STATS
+        free(stats);
+#endif
+
+        return ok;
+}
+#endif
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_batch
+        描述:   使用json解析器批量解析多个json字符串，共用一个会话栈，结果
+                分配在解析器的结果区中，解析当前json时预取下一个json。
+                threads大于1且开启XJSON_ENABLE_THREADS时分段并行解析
+
+        input:  p,              json解析器
+                docs,           json字符串，无需以'\0'结尾
+                lens,           json字符串长度
+                n,              json字符串个数
+                out,            json对象，用于存储json解析结果
+                status,         用于存储各json的解析结果，可以为NULL
+
+        output: out             json解析结果，不能调用xjson_free或修改函数，
+                                由xjson_parser_free_batch统一释放
+                status          同xjson_parse
+
+        return: success, 解析成功的json个数
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t
+xjson_parse_batch(xjson_parser *p, const char *const docs[], const size_t lens[], size_t n,
+                xjson_value out[], int status[]) {
+        assert(p != NULL && ((docs != NULL && lens != NULL && out != NULL) || n == 0));
+
+        xjson_batch b;
+        b.docs = docs;
+        b.lens = lens;
+        b.out = out;
+        b.status = status;
+        b.n = n;
+        b.flags = p->flags;
+        b.stack = p->stack;
+        b.size = p->size;
+        b.arena = p->arena;
+        b.stats = &p->stats;
+
+#ifdef XJSON_ENABLE_THREADS
+        if (p->threads > 1 && n > 1) {
+                return xjson_parse_batch_threads(&b, p, p->threads < n ? p->threads : (unsigned)n);
+        }
+#endif
+
+        xjson_batch_run(&b);
+        p->stack = b.stack;
+        p->size = b.size;
+        p->arena = b.arena;
+
+        return b.ok;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parser_free_batch
+        描述:   释放xjson_parse_batch的全部解析结果，保留当前内存块供复用
+
+        input:  p,              json解析器
+
+        output: p               清空结果区的json解析器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_parser_free_batch(xjson_parser *p) {
+        assert(p != NULL);
+        xjson_arena_clear(&p->arena, xjson_true);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_validate
+        描述:   只校验json字符串，不构建json对象，也不分配内存
+
+        input:  json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+                offset,         可以为NULL
+
+        output: offset          成功时为len，失败时为检测到错误的位置
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int
+xjson_validate(const char *json, size_t len, size_t *offset) {
+        assert(json != NULL || len == 0);
+
+        xjson_context c;
+        xjson_context_init(&c, json, len);
+
+        xjson_parse_whitespace(&c);
+        int ret = xjson_validate_value(&c);
+        if (ret == XJSON_PARSE_OK) {
+                xjson_parse_whitespace(&c);
+                if (c.json != c.end) {
+                        ret = XJSON_PARSE_ROOT_NOT_SINGULAR;
+                }
+        }
+
+        if (offset != NULL) {
+                *offset = c.json - json;
+        }
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_required_size
+        描述:   计算xjson_parse_static解析json字符串所需的缓冲区大小，
+                只校验一遍json字符串，不分配内存
+
+        input:  json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+                size,           用于存储缓冲区大小
+
+        output: size            成功时为所需的缓冲区大小
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int
+xjson_required_size(const char *json, size_t len, size_t *size) {
+        assert((json != NULL || len == 0) && size != NULL);
+
+        xjson_context c;
+        xjson_context_init(&c, json, len);
+
+        xjson_parse_whitespace(&c);
+        int ret = xjson_validate_value(&c);
+        if (ret == XJSON_PARSE_OK) {
+                xjson_parse_whitespace(&c);
+                if (c.json != c.end) {
+                        ret = XJSON_PARSE_ROOT_NOT_SINGULAR;
+                }
+        }
+
+        if (ret == XJSON_PARSE_OK) {
+                assert(c.top == 0);
+                *size = ALIGN_UP(c.peak);
+        }
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_static
+        描述:   在调用者提供的缓冲区中解析json字符串，不使用malloc。会话栈
+                自缓冲区低地址向上增长，json对象与字符串自高地址向下分配
+
+        input:  v,              json对象，用于存储json解析结果
+                json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+                buf,            缓冲区，须按double对齐，cap为0时可以为NULL
+                cap,            缓冲区大小，xjson_required_size的结果即足够
+
+        output: v               json解析结果，其内存全部位于buf中，不能调用
+                                xjson_free或修改函数，buf释放后即失效
+
+        return: success, XJSON_PARSE_OK
+                failure, 同xjson_parse ||
+                         XJSON_PARSE_OUT_OF_MEMORY
+ *---------------------------------------------------------------------------*/
+int
+xjson_parse_static(xjson_value *v, const char *json, size_t len, void *buf, size_t cap) {
+        assert(v != NULL && (json != NULL || len == 0) && (buf != NULL || cap == 0));
+
+        uintptr_t begin = (uintptr_t)buf, end = begin + cap;
+        begin = ALIGN_UP(begin);
+        end &= ~(uintptr_t)(sizeof(xjson_align) - 1);
+
+        xjson_context c;
+        xjson_context_init(&c, json, len);
+        c.fixed = xjson_true;
+        c.stack = (char *)begin;
+        c.heap = (char *)(end > begin ? end : begin);
+
+        int ret = xjson_parse_root(&c, v);
+        assert(c.top == 0);
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_skip_string
+        描述:   跳过string，不解码转义序列，也不校验字符
+
+        input:  c,              json会话，指向'"'
+
+        output: c               指向string之后
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_MISS_QUOTATION_MARK
+ *---------------------------------------------------------------------------*/
+static int
+xjson_skip_string(xjson_context *c) {
+        const char *p = c->json + 1, *end = c->end;
+        int ascii;
+
+        for (;;) {
+                p = xjson_scan_string(p, end, &ascii);
+                if (p == end) {
+                        c->json = p;
+                        return XJSON_PARSE_MISS_QUOTATION_MARK;
+                }
+                if (*p == '\"') {
+                        c->json = p + 1;
+                        return XJSON_PARSE_OK;
+                }
+                p += *p == '\\' && p + 1 < end ? 2 : 1;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_skip_value
+        描述:   跳过一个json token，只检查string是否闭合以及括号是否配对，
+                不解析literal和number，也不解码string
+
+        input:  c,              json会话
+
+        output: c               指向token之后
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_EXPECT_VALUE ||
+                         XJSON_PARSE_INVALID_VALUE ||
+                         XJSON_PARSE_MISS_QUOTATION_MARK ||
+                         XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET
+ *---------------------------------------------------------------------------*/
+static int
+xjson_skip_value(xjson_context *c) {
+        const char *p;
+        size_t depth = 0;
+        int ret;
+
+        do {
+                switch (PEEK(c)) {
+                        case '\"':
+                                if ((ret = xjson_skip_string(c)) != XJSON_PARSE_OK) {
+                                        return ret;
+                                }
+                                break;
+                        case '[':
+                                depth++;
+                                c->json++;
+                                break;
+                        case ']':
+                                if (depth == 0) {
+                                        return XJSON_PARSE_INVALID_VALUE;
+                                }
+                                depth--;
+                                c->json++;
+                                break;
+                        case '\0':
+                                return depth > 0 ?
+                                        XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET :
+                                        XJSON_PARSE_EXPECT_VALUE;
+                        default:
+                                if (depth > 0) {
+                                        c->json++;
+                                        break;
+                                }
+                                for (p = c->json; p < c->end && *p != ',' && *p != ']' &&
+                                     *p != ' ' && *p != '\n' && *p != '\t' && *p != '\r'; p++) {
+                                }
+                                if (p == c->json) {
+                                        return XJSON_PARSE_INVALID_VALUE;
+                                }
+                                c->json = p;
+                                break;
+                }
+        } while (depth > 0);
+
+        return XJSON_PARSE_OK;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_check_path
+        描述:   检查投影路径格式，路径为""或由若干"/下标"组成，下标可以为"*"
+
+        input:  path,           投影路径
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+static void
+xjson_check_path(const char *path) {
+        assert(path != NULL);
+
+        while (*path != '\0') {
+                assert(*path == '/');
+                path++;
+                if (*path == '*') {
+                        path++;
+                } else {
+                        assert(ISDIGIT(*path));
+                        assert(*path != '0' || !ISDIGIT(path[1]));
+                        while (ISDIGIT(*path)) {
+                                path++;
+                        }
+                }
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_match_path
+        描述:   判断投影路径的第一段是否选中array下标index
+
+        input:  path,           投影路径，不为""
+                index,          array下标
+
+        output: None
+
+        return: 选中, 剩余路径
+                未选中, NULL
+ *---------------------------------------------------------------------------*/
+static const char *
+xjson_match_path(const char *path, size_t index) {
+        size_t i = 0;
+
+        if (*++path == '*') {
+                return path + 1;
+        }
+
+        for (; ISDIGIT(*path); path++) {
+                if (i > index) {
+                        return NULL;
+                }
+                i = i * 10 + (*path - '0');
+        }
+
+        return i == index ? path : NULL;
+}
+
+static int xjson_parse_projected_array(xjson_context *c, xjson_value *v, size_t paths, size_t n);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_projected_value
+        描述:   解析被投影路径选中的部分，其余部分跳过并置为null。
+                路径保存在会话栈中，栈可能被重新分配，因此以偏移传递
+
+        input:  c,              json会话
+                v,              json对象，已初始化为null
+                paths,          剩余路径在会话栈中的偏移
+                n,              剩余路径个数
+
+        output: v               解析结果
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_projected_value(xjson_context *c, xjson_value *v, size_t paths, size_t n) {
+        const char *path;
+
+        for (size_t i = 0; i < n; i++) {
+                memcpy(&path, c->stack + paths + i * sizeof(path), sizeof(path));
+                if (*path == '\0') {
+                        return xjson_parse_value(c, v);
+                }
+        }
+
+        if (n == 0 || PEEK(c) != '[') {
+                return xjson_skip_value(c);
+        }
+
+        return xjson_parse_projected_array(c, v, paths, n);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_projected_array
+        描述:   同xjson_parse_array，每个成员只按选中它的路径解析
+
+        input:  c,              json会话，指向'['
+                v,              json对象
+                paths,          剩余路径在会话栈中的偏移
+                n,              剩余路径个数
+
+        output: v               解析结果，保留未选中成员的位置
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_projected_array(xjson_context *c, xjson_value *v, size_t paths, size_t n) {
+        EXPECT(c, '[');
+
+        const char *path;
+        size_t size = 0, sub, k;
+        int ret;
+
+        xjson_parse_whitespace(c);
+        if (PEEK(c) == ']') {
+                c->json++;
+                v->type = XJSON_ARRAY;
+                v->u.a.size = v->u.a.capacity = 0;
+                v->u.a.e = NULL;
+
+                return XJSON_PARSE_OK;
+        }
+
+        for (;;) {
+                xjson_value e;
+                xjson_init(&e);
+
+                sub = c->top;
+                for (size_t i = k = 0; i < n; i++) {
+                        memcpy(&path, c->stack + paths + i * sizeof(path), sizeof(path));
+                        if ((path = xjson_match_path(path, size)) != NULL) {
+                                memcpy(xjson_context_push(c, sizeof(path)), &path, sizeof(path));
+                                k++;
+                        }
+                }
+
+                ret = xjson_parse_projected_value(c, &e, sub, k);
+                xjson_context_pop(c, k * sizeof(path));
+                if (ret != XJSON_PARSE_OK) {
+                        break;
+                }
+
+                memcpy(xjson_context_push(c, sizeof(xjson_value)), &e, sizeof(xjson_value));
+                size++;
+
+                xjson_parse_whitespace(c);
+                if (PEEK(c) == ',') {
+                        c->json++;
+                        xjson_parse_whitespace(c);
+
+                } else if (PEEK(c) == ']') {
+                        c->json++;
+                        v->type = XJSON_ARRAY;
+                        v->u.a.size = v->u.a.capacity = size;
+                        size *= sizeof(xjson_value);
+
+                        memcpy(v->u.a.e = (xjson_value *)xjson_context_alloc(c, size), xjson_context_pop(c, size), size);
+                        return XJSON_PARSE_OK;
+
+                } else {
+                        ret = XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                        break;
+                }
+        }
+
+        for (size_t i = 0; i < size; i++) {
+                xjson_free((xjson_value*)xjson_context_pop(c, sizeof(xjson_value)));
+        }
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_projected
+        描述:   只解析投影路径选中的部分。路径形如"/0/2"，下标"*"选中
+                array全部成员，""选中整个json。未选中的成员置为null以保留
+                下标，其内容只检查string闭合与括号配对，不解析也不解码
+
+        input:  v,              json对象
+                json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+                paths,          投影路径，可以为NULL
+                n,              投影路径个数
+
+        output: v               解析结果，失败时为null
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int
+xjson_parse_projected(xjson_value *v, const char *json, size_t len, const char *const paths[], size_t n) {
+        assert(v != NULL && (json != NULL || len == 0) && (paths != NULL || n == 0));
+
+        xjson_context c;
+        xjson_context_init(&c, json, len);
+
+        for (size_t i = 0; i < n; i++) {
+                xjson_check_path(paths[i]);
+                memcpy(xjson_context_push(&c, sizeof(paths[i])), &paths[i], sizeof(paths[i]));
+        }
+
+        xjson_init(v);
+        xjson_parse_whitespace(&c);
+        int ret = xjson_parse_projected_value(&c, v, 0, n);
+        xjson_context_pop(&c, n * sizeof(paths[0]));
+        if (ret == XJSON_PARSE_OK) {
+                xjson_parse_whitespace(&c);
+                if (c.json != c.end) {
+                        xjson_free(v);
+                        ret = XJSON_PARSE_ROOT_NOT_SINGULAR;
+                }
+        }
+
+        assert(c.top == 0);
+        free(c.stack);
+
+        return ret;
+}
+
+/* json对象及其span，在会话栈中成对暂存 */
+typedef struct {
+        xjson_value     v;
+        xjson_span      s;
+}xjson_spanned;
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_span_free
+        描述:   释放span树
+
+        input:  s,              span
+
+        output: s               没有成员的span
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_span_free(xjson_span *s) {
+        for (size_t i = 0; i < s->count; i++) {
+                xjson_span_free(&s->children[i]);
+        }
+        free(s->children);
+        s->children = NULL;
+        s->count = 0;
+}
+
+static int xjson_parse_spanned_array(xjson_context *c, xjson_value *v, xjson_span *s);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_spanned
+        描述:   同xjson_parse_value，同时记录各json对象在json中的位置
+
+        input:  c,              json会话
+                v,              json对象
+                s,              span
+                base,           父对象的起始位置
+
+        output: v               json解析结果
+                s               v的位置，offset相对于base
+
+        return: 同xjson_parse_value
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_spanned(xjson_context *c, xjson_value *v, xjson_span *s, const char *base) {
+        const char *begin = c->json;
+        int ret;
+
+        s->offset = begin - base;
+        s->children = NULL;
+        s->count = 0;
+        ret = PEEK(c) == '[' ? xjson_parse_spanned_array(c, v, s) : xjson_parse_value(c, v);
+        s->length = c->json - begin;
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_spanned_array
+        描述:   同xjson_parse_array，成员与其span成对压栈
+
+        input:  c,              json会话，指向'['
+                v,              json对象
+                s,              array的span
+
+        output: v               json解析结果
+                s               成员的span
+
+        return: 同xjson_parse_array
+ *---------------------------------------------------------------------------*/
+static int
+xjson_parse_spanned_array(xjson_context *c, xjson_value *v, xjson_span *s) {
+        const char *begin = c->json;
+        size_t size = 0;
+        int ret;
+
+        EXPECT(c, '[');
+        xjson_parse_whitespace(c);
+        if (PEEK(c) == ']') {
+                c->json++;
+                v->type = XJSON_ARRAY;
+                v->u.a.size = v->u.a.capacity = 0;
+                v->u.a.e = NULL;
+
+                return XJSON_PARSE_OK;
+        }
+
+        for (;;) {
+                xjson_spanned e;
+                xjson_init(&e.v);
+
+                if ((ret = xjson_parse_spanned(c, &e.v, &e.s, begin)) != XJSON_PARSE_OK) {
+                        xjson_span_free(&e.s);
+                        break;
+                }
+
+                memcpy(xjson_context_push(c, sizeof(e)), &e, sizeof(e));
+                size++;
+
+                xjson_parse_whitespace(c);
+                if (PEEK(c) == ',') {
+                        c->json++;
+                        xjson_parse_whitespace(c);
+
+                } else if (PEEK(c) == ']') {
+                        c->json++;
+                        v->type = XJSON_ARRAY;
+                        v->u.a.size = v->u.a.capacity = s->count = size;
+                        v->u.a.e = (xjson_value *)malloc(size * sizeof(xjson_value));
+                        s->children = (xjson_span *)malloc(size * sizeof(xjson_span));
+
+                        xjson_spanned *top = (xjson_spanned *)xjson_context_pop(c, size * sizeof(e));
+                        for (size_t i = 0; i < size; i++) {
+                                v->u.a.e[i] = top[i].v;
+                                s->children[i] = top[i].s;
+                        }
+                        return XJSON_PARSE_OK;
+
+                } else {
+                        ret = XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                        break;
+                }
+        }
+
+        for (size_t i = 0; i < size; i++) {
+                xjson_spanned *e = (xjson_spanned *)xjson_context_pop(c, sizeof(xjson_spanned));
+                xjson_free(&e->v);
+                xjson_span_free(&e->s);
+        }
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_document_parse
+        描述:   重新解析整个文本，失败时根对象为null
+
+        input:  d,              json文档
+
+        output: d               解析结果与span树
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+static int
+xjson_document_parse(xjson_document *d) {
+        xjson_context c;
+        int ret;
+
+        xjson_free(&d->root);
+        xjson_span_free(&d->span);
+
+        xjson_context_init(&c, d->text, d->length);
+        xjson_parse_whitespace(&c);
+        ret = xjson_parse_spanned(&c, &d->root, &d->span, d->text);
+        if (ret == XJSON_PARSE_OK) {
+                xjson_parse_whitespace(&c);
+                if (c.json != c.end) {
+                        ret = XJSON_PARSE_ROOT_NOT_SINGULAR;
+                }
+        }
+        if (ret != XJSON_PARSE_OK) {
+                xjson_free(&d->root);
+                xjson_span_free(&d->span);
+                d->span.offset = d->span.length = 0;
+        }
+
+        assert(c.top == 0);
+        free(c.stack);
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_document_splice
+        描述:   在array中找到严格包含编辑区域的最小array，只重新解析该
+                array并替换，再修正祖先的长度与之后兄弟的偏移
+
+        input:  d,              json文档，文本已修改
+                v,              array，编辑区域严格位于其括号之间
+                s,              v的span
+                begin,          v编辑前在文本中的起始位置
+                offset,         编辑起始位置
+                removed,        删除的长度
+                delta,          文本长度的变化，按size_t回绕表示负数
+
+        output: v, s            重新解析的结果
+
+        return: success, XJSON_PARSE_OK
+                failure, 重新解析的结果不是恰好一个array时返回解析错误，
+                         v、s保持不变
+ *---------------------------------------------------------------------------*/
+static int
+xjson_document_splice(xjson_document *d, xjson_value *v, xjson_span *s, size_t begin,
+                size_t offset, size_t removed, size_t delta) {
+        size_t lo = 0, hi = s->count, i;
+        int ret;
+
+        /* 成员按位置有序，二分查找起始位置不大于offset的最后一个成员 */
+        while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (begin + s->children[mid].offset <= offset) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+
+        if (lo > 0) {
+                i = lo - 1;
+                xjson_span *child = &s->children[i];
+                size_t child_begin = begin + child->offset;
+                if (v->u.a.e[i].type == XJSON_ARRAY && offset > child_begin &&
+                    offset + removed < child_begin + child->length) {
+                        ret = xjson_document_splice(d, &v->u.a.e[i], child, child_begin, offset, removed, delta);
+                        if (ret == XJSON_PARSE_OK) {
+                                for (i++; i < s->count; i++) {
+                                        s->children[i].offset += delta;
+                                }
+                                s->length += delta;
+                        }
+                        return ret;
+                }
+        }
+
+        xjson_context c;
+        xjson_value nv;
+        xjson_span ns;
+
+        xjson_context_init(&c, d->text + begin, s->length + delta);
+        xjson_init(&nv);
+        ret = xjson_parse_spanned(&c, &nv, &ns, d->text + begin - s->offset);
+        if (ret == XJSON_PARSE_OK && (c.json != c.end || nv.type != XJSON_ARRAY)) {
+                ret = XJSON_PARSE_ROOT_NOT_SINGULAR;
+        }
+        if (ret == XJSON_PARSE_OK) {
+                xjson_free(v);
+                xjson_span_free(s);
+                *v = nv;
+                *s = ns;
+        } else {
+                xjson_free(&nv);
+                xjson_span_free(&ns);
+        }
+
+        assert(c.top == 0);
+        free(c.stack);
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_document_init
+        描述:   复制json字符串并解析，记录各json对象的位置供增量解析
+
+        input:  d,              json文档
+                json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+
+        output: d               json文档，解析失败时根对象为null
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int
+xjson_document_init(xjson_document *d, const char *json, size_t len) {
+        assert(d != NULL && (json != NULL || len == 0));
+
+        d->capacity = len + 1;
+        d->text = (char *)malloc(d->capacity);
+        if (len > 0) {
+                memcpy(d->text, json, len);
+        }
+        d->text[len] = '\0';
+        d->length = len;
+        xjson_init(&d->root);
+        d->span.children = NULL;
+        d->span.count = 0;
+
+        return xjson_document_parse(d);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_document_free
+        描述:   释放json文档
+
+        input:  d,              json文档
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_document_free(xjson_document *d) {
+        assert(d != NULL);
+
+        xjson_free(&d->root);
+        xjson_span_free(&d->span);
+        free(d->text);
+        d->text = NULL;
+        d->length = d->capacity = 0;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_reparse
+        描述:   修改json文档的文本并增量解析。只重新解析严格包含编辑区域
+                的最小array，其余json对象保持不变，之后对象的位置随之平移；
+                不存在这样的array或其不再是恰好一个array时解析整个文本
+
+        input:  d,              json文档
+                offset,         编辑起始位置
+                removed,        删除的长度
+                inserted,       插入的文本，可以为NULL
+                len,            插入的文本长度
+
+        output: d               修改后的文本与解析结果，失败时根对象为null
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int
+xjson_reparse(xjson_document *d, size_t offset, size_t removed, const char *inserted, size_t len) {
+        assert(d != NULL && (inserted != NULL || len == 0));
+        assert(offset <= d->length && removed <= d->length - offset);
+
+        size_t length = d->length - removed + len;
+        if (length + 1 > d->capacity) {
+                d->capacity = length + 1 + (length >> 1);
+                d->text = (char *)realloc(d->text, d->capacity);
+        }
+        memmove(d->text + offset + len, d->text + offset + removed, d->length - offset - removed + 1);
+        if (len > 0) {
+                memcpy(d->text + offset, inserted, len);
+        }
+        d->length = length;
+
+        if (d->root.type == XJSON_ARRAY && offset > d->span.offset &&
+            offset + removed < d->span.offset + d->span.length &&
+            xjson_document_splice(d, &d->root, &d->span, d->span.offset, offset, removed,
+                    len - removed) == XJSON_PARSE_OK) {
+                return XJSON_PARSE_OK;
+        }
+
+        return xjson_document_parse(d);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_store_integer
+        描述:   按字段宽度写入有符号整数
+
+        input:  field,          字段地址
+                size,           字段宽度，可以为1、2、4、8
+                x,              写入的值，须在字段范围内
+
+        output: field           写入的值
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_store_integer(void *field, size_t size, long long x) {
+        int8_t i8 = (int8_t)x;
+        int16_t i16 = (int16_t)x;
+        int32_t i32 = (int32_t)x;
+        int64_t i64 = (int64_t)x;
+
+        switch (size) {
+                case 1: memcpy(field, &i8, 1); break;
+                case 2: memcpy(field, &i16, 2); break;
+                case 4: memcpy(field, &i32, 4); break;
+                default:
+                        assert(size == 8);
+                        memcpy(field, &i64, 8);
+                        break;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_load_integer
+        描述:   按字段宽度读取有符号整数
+
+        input:  field,          字段地址
+                size,           字段宽度，可以为1、2、4、8
+
+        output: None
+
+        return: 字段的值
+ *---------------------------------------------------------------------------*/
+static long long
+xjson_load_integer(const void *field, size_t size) {
+        int8_t i8;
+        int16_t i16;
+        int32_t i32;
+        int64_t i64;
+
+        switch (size) {
+                case 1: memcpy(&i8, field, 1); return i8;
+                case 2: memcpy(&i16, field, 2); return i16;
+                case 4: memcpy(&i32, field, 4); return i32;
+                default:
+                        assert(size == 8);
+                        memcpy(&i64, field, 8);
+                        return i64;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_decode_integer
+        描述:   将整数number直接解码至整数字段，不经过double
+
+        input:  p,              number起始位置，须已通过xjson_scan_number校验
+                end,            number结束位置
+                f,              字段描述
+                field,          字段地址
+
+        output: field           解码结果
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_DECODE_TYPE_MISMATCH ||
+                         XJSON_DECODE_OUT_OF_RANGE
+ *---------------------------------------------------------------------------*/
+static int
+xjson_decode_integer(const char *p, const char *end, const xjson_field_desc *f, void *field) {
+        unsigned long long x = 0, max;
+        int negative = *p == '-';
+
+        max = f->size >= 8 ? ~0ULL >> 1 : (1ULL << (f->size * 8 - 1)) - 1;
+        max += negative;
+
+        for (p += negative; p < end; p++) {
+                if (!ISDIGIT(*p)) {
+                        return XJSON_DECODE_TYPE_MISMATCH;
+                }
+                if (x > (max - (*p - '0')) / 10) {
+                        return XJSON_DECODE_OUT_OF_RANGE;
+                }
+                x = x * 10 + (*p - '0');
+        }
+
+        xjson_store_integer(field, f->size, negative ? (long long)(0 - x) : (long long)x);
+        return XJSON_PARSE_OK;
+}
+
+static int xjson_decode_fields(xjson_context *c, const xjson_field_desc *desc, char *out);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_decode_field
+        描述:   将一个json token直接解码至结构体字段，null将字段清零
+
+        input:  c,              json会话
+                f,              字段描述
+                field,          字段地址
+
+        output: field           解码结果
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_*错误 ||
+                         XJSON_DECODE_TYPE_MISMATCH ||
+                         XJSON_DECODE_COUNT_MISMATCH ||
+                         XJSON_DECODE_OUT_OF_RANGE
+ *---------------------------------------------------------------------------*/
+static int
+xjson_decode_field(xjson_context *c, const xjson_field_desc *f, char *field) {
+        xjson_value v;
+        const char *p;
+        size_t len;
+        int ret;
+
+        switch (PEEK(c)) {
+                case 'n':
+                        if ((ret = xjson_parse_literal(c, &v, "null", XJSON_NULL)) == XJSON_PARSE_OK) {
+                                memset(field, 0, f->size);
+                        }
+                        return ret;
+                case 't':
+                case 'f':
+                        if (f->type != XJSON_FIELD_BOOLEAN) {
+                                return XJSON_DECODE_TYPE_MISMATCH;
+                        }
+                        ret = PEEK(c) == 't' ?
+                                xjson_parse_literal(c, &v, "true", XJSON_TRUE) :
+                                xjson_parse_literal(c, &v, "false", XJSON_FALSE);
+                        if (ret == XJSON_PARSE_OK) {
+                                xjson_store_integer(field, f->size, v.type == XJSON_TRUE);
+                        }
+                        return ret;
+                case '"':
+                        if (f->type != XJSON_FIELD_STRING) {
+                                return XJSON_DECODE_TYPE_MISMATCH;
+                        }
+                        if ((ret = xjson_parse_string_raw(c, &len)) != XJSON_PARSE_OK) {
+                                return ret;
+                        }
+                        p = (const char *)xjson_context_pop(c, len);
+                        if (len >= f->size) {
+                                return XJSON_DECODE_OUT_OF_RANGE;
+                        }
+                        if (len > 0) {
+                                memcpy(field, p, len);
+                        }
+                        field[len] = '\0';
+                        return XJSON_PARSE_OK;
+                case '[':
+                        if (f->type != XJSON_FIELD_STRUCT) {
+                                return XJSON_DECODE_TYPE_MISMATCH;
+                        }
+                        return xjson_decode_fields(c, f->nested, field);
+                case '\0':
+                        return XJSON_PARSE_EXPECT_VALUE;
+                default:
+                        if ((p = xjson_scan_number(c->json, c->end)) == NULL) {
+                                return XJSON_PARSE_INVALID_VALUE;
+                        }
+                        if (f->type == XJSON_FIELD_INT) {
+                                if ((ret = xjson_decode_integer(c->json, p, f, field)) == XJSON_PARSE_OK) {
+                                        c->json = p;
+                                }
+                                return ret;
+                        }
+                        if (f->type != XJSON_FIELD_DOUBLE) {
+                                return XJSON_DECODE_TYPE_MISMATCH;
+                        }
+                        if ((ret = xjson_parse_number(c, &v)) == XJSON_PARSE_OK) {
+                                if (f->size == sizeof(float)) {
+                                        float x = (float)v.u.n.number;
+                                        memcpy(field, &x, sizeof(x));
+                                } else {
+                                        assert(f->size == sizeof(double));
+                                        memcpy(field, &v.u.n.number, sizeof(double));
+                                }
+                        }
+                        return ret;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_decode_fields
+        描述:   将json array按位置依次解码至结构体字段，成员个数须与字段个数一致
+
+        input:  c,              json会话，指向'['
+                desc,           字段描述表
+                out,            结构体地址
+
+        output: out             解码结果
+
+        return: 同xjson_decode_field
+ *---------------------------------------------------------------------------*/
+static int
+xjson_decode_fields(xjson_context *c, const xjson_field_desc *desc, char *out) {
+        const xjson_field_desc *f;
+        int ret;
+
+        EXPECT(c, '[');
+        for (f = desc; f->type != XJSON_FIELD_END; f++) {
+                xjson_parse_whitespace(c);
+                if (f != desc) {
+                        if (PEEK(c) != ',') {
+                                return PEEK(c) == ']' ?
+                                        XJSON_DECODE_COUNT_MISMATCH :
+                                        XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                        }
+                        c->json++;
+                        xjson_parse_whitespace(c);
+                } else if (PEEK(c) == ']') {
+                        return XJSON_DECODE_COUNT_MISMATCH;
+                }
+
+                if ((ret = xjson_decode_field(c, f, out + f->offset)) != XJSON_PARSE_OK) {
+                        return ret;
+                }
+        }
+
+        xjson_parse_whitespace(c);
+        if (PEEK(c) == ']') {
+                c->json++;
+                return XJSON_PARSE_OK;
+        }
+
+        return PEEK(c) == ',' ? XJSON_DECODE_COUNT_MISMATCH : XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_decode_struct
+        描述:   按字段描述表将json array直接解码至结构体，不构建json对象。
+                array成员按位置对应字段，嵌套结构体对应嵌套array
+
+        input:  json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+                desc,           字段描述表，以XJSON_FIELD_LAST结束
+                out,            结构体地址
+
+        output: out             解码结果，失败时部分字段可能已被写入
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_*错误 ||
+                         XJSON_DECODE_TYPE_MISMATCH ||
+                         XJSON_DECODE_COUNT_MISMATCH ||
+                         XJSON_DECODE_OUT_OF_RANGE
+ *---------------------------------------------------------------------------*/
+int
+xjson_decode_struct(const char *json, size_t len, const xjson_field_desc *desc, void *out) {
+        assert((json != NULL || len == 0) && desc != NULL && out != NULL);
+
+        xjson_context c;
+        xjson_context_init(&c, json, len);
+
+        int ret;
+        xjson_parse_whitespace(&c);
+        switch (PEEK(&c)) {
+                case '[':
+                        ret = xjson_decode_fields(&c, desc, (char *)out);
+                        break;
+                case '\0':
+                        ret = XJSON_PARSE_EXPECT_VALUE;
+                        break;
+                default:
+                        ret = XJSON_DECODE_TYPE_MISMATCH;
+                        break;
+        }
+
+        if (ret == XJSON_PARSE_OK) {
+                xjson_parse_whitespace(&c);
+                if (c.json != c.end) {
+                        ret = XJSON_PARSE_ROOT_NOT_SINGULAR;
+                }
+        }
+
+        free(c.stack);
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_escape_char
+        描述:   生成字符串中须转义字符的转义序列
+
+        input:  ch,             '"'、'\\'或控制字符
+                esc,            至少6字节
+
+        output: esc             转义序列
+
+        return: 转义序列长度
+ *---------------------------------------------------------------------------*/
+static size_t
+xjson_escape_char(char ch, char *esc) {
+        static const char hex[] = "0123456789ABCDEF";
+
+        esc[0] = '\\';
+        switch (ch) {
+                case '\"': esc[1] = '\"'; return 2;
+                case '\\': esc[1] = '\\'; return 2;
+                case '\b': esc[1] = 'b'; return 2;
+                case '\f': esc[1] = 'f'; return 2;
+                case '\n': esc[1] = 'n'; return 2;
+                case '\r': esc[1] = 'r'; return 2;
+                case '\t': esc[1] = 't'; return 2;
+                default:
+                        esc[1] = 'u';
+                        esc[2] = esc[3] = '0';
+                        esc[4] = hex[(unsigned char)ch >> 4];
+                        esc[5] = hex[ch & 0xf];
+                        return 6;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_format_integer
+        描述:   将整数格式化为十进制字符串，不经过snprintf
+
+        input:  x,              整数
+                buf,            至少20字节
+
+        output: buf             十进制字符串，不以'\0'结尾
+
+        return: 字符串长度
+ *---------------------------------------------------------------------------*/
+static size_t
+xjson_format_integer(long long x, char *buf) {
+        unsigned long long u = x < 0 ? 0 - (unsigned long long)x : (unsigned long long)x;
+        char digits[20];
+        size_t n = 0, len = 0;
+
+        do {
+                digits[n++] = '0' + u % 10;
+                u /= 10;
+        } while (u != 0);
+
+        if (x < 0) {
+                buf[len++] = '-';
+        }
+        while (n > 0) {
+                buf[len++] = digits[--n];
+        }
+
+        return len;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_format_number
+        描述:   将double格式化为json number。可精确表示的整数直接输出
+                十进制数字，其余使用"%.17g"保证转换回double时不变
+
+        input:  d,              双精度浮点型数值
+                buf,            至少32字节
+
+        output: buf             json number，inf与nan输出为null，
+                                不以'\0'结尾
+
+        return: 字符串长度
+ *---------------------------------------------------------------------------*/
+static size_t
+xjson_format_number(double d, char *buf) {
+        if (d - d != 0.0) {
+                memcpy(buf, "null", 4);
+                return 4;
+        }
+
+        if (d >= -9007199254740992.0 && d <= 9007199254740992.0 &&
+            d == (double)(long long)d && !(d == 0.0 && signbit(d))) {
+                return xjson_format_integer((long long)d, buf);
+        }
+
+        return snprintf(buf, 32, "%.17g", d);
+}
+
+/* 调用者提供的输出缓冲区，超出容量的部分只计长度 */
+typedef struct {
+        char            *buf;
+        size_t          cap, len;
+}xjson_buffer;
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_buffer_write
+        描述:   向输出缓冲区写入数据，保留一个字节用于'\0'
+
+        input:  b,              输出缓冲区
+                s,              数据
+                n,              数据长度
+
+        output: b               写入后的输出缓冲区
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_buffer_write(xjson_buffer *b, const char *s, size_t n) {
+        if (b->len + 1 < b->cap) {
+                size_t room = b->cap - 1 - b->len;
+                memcpy(b->buf + b->len, s, n < room ? n : room);
+        }
+
+        b->len += n;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_encode_string
+        描述:   将字符串转义后写入输出缓冲区，无需转义的部分整段复制
+
+        input:  b,              输出缓冲区
+                s,              字符串
+                len,            字符串长度
+
+        output: b               写入后的输出缓冲区
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_encode_string(xjson_buffer *b, const char *s, size_t len) {
+        const char *p = s, *end = s + len, *q;
+        char esc[6];
+        int ascii;
+
+        xjson_buffer_write(b, "\"", 1);
+        for (;;) {
+                q = xjson_scan_string(p, end, &ascii);
+                xjson_buffer_write(b, p, q - p);
+                if (q == end) {
+                        break;
+                }
+
+                xjson_buffer_write(b, esc, xjson_escape_char(*q, esc));
+                p = q + 1;
+        }
+        xjson_buffer_write(b, "\"", 1);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_encode_fields
+        描述:   按字段描述表将结构体编码为json array
+
+        input:  b,              输出缓冲区
+                desc,           字段描述表
+                in,             结构体地址
+
+        output: b               写入后的输出缓冲区
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_encode_fields(xjson_buffer *b, const xjson_field_desc *desc, const char *in) {
+        const xjson_field_desc *f;
+        const char *nul;
+        char number[32];
+        double d;
+        float x;
+
+        xjson_buffer_write(b, "[", 1);
+        for (f = desc; f->type != XJSON_FIELD_END; f++) {
+                const char *field = in + f->offset;
+
+                if (f != desc) {
+                        xjson_buffer_write(b, ",", 1);
+                }
+
+                switch (f->type) {
+                        case XJSON_FIELD_BOOLEAN:
+                                if (xjson_load_integer(field, f->size)) {
+                                        xjson_buffer_write(b, "true", 4);
+                                } else {
+                                        xjson_buffer_write(b, "false", 5);
+                                }
+                                break;
+                        case XJSON_FIELD_INT:
+                                xjson_buffer_write(b, number,
+                                        xjson_format_integer(xjson_load_integer(field, f->size), number));
+                                break;
+                        case XJSON_FIELD_DOUBLE:
+                                if (f->size == sizeof(float)) {
+                                        memcpy(&x, field, sizeof(x));
+                                        d = x;
+                                } else {
+                                        memcpy(&d, field, sizeof(d));
+                                }
+                                xjson_buffer_write(b, number, xjson_format_number(d, number));
+                                break;
+                        case XJSON_FIELD_STRING:
+                                nul = (const char *)memchr(field, '\0', f->size);
+                                xjson_encode_string(b, field, nul ? (size_t)(nul - field) : f->size);
+                                break;
+                        case XJSON_FIELD_STRUCT:
+                                xjson_encode_fields(b, f->nested, field);
+                                break;
+                        default:
+                                assert(0);
+                }
+        }
+        xjson_buffer_write(b, "]", 1);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_encode_struct
+        描述:   按字段描述表将结构体编码为json array，与xjson_decode_struct互逆
+
+        input:  in,             结构体地址
+                desc,           字段描述表，以XJSON_FIELD_LAST结束
+                buf,            输出缓冲区，可以为NULL
+                cap,            输出缓冲区大小
+
+        output: buf             json字符串，cap大于0时总以'\0'结尾，
+                                空间不足时被截断
+
+        return: success, 完整json字符串的长度，不含'\0'
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t
+xjson_encode_struct(const void *in, const xjson_field_desc *desc, char *buf, size_t cap) {
+        assert(in != NULL && desc != NULL && (buf != NULL || cap == 0));
+
+        xjson_buffer b;
+        b.buf = buf;
+        b.cap = cap;
+        b.len = 0;
+
+        xjson_encode_fields(&b, desc, (const char *)in);
+        if (cap > 0) {
+                buf[b.len < cap ? b.len : cap - 1] = '\0';
+        }
+
+        return b.len;
+}
+
+#define XJSON_WRITER_OBJECT     0x1     // 当前层为object
+#define XJSON_WRITER_MEMBER     0x2     // 当前层已有成员
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_drain
+        描述:   将缓冲区中的数据全部交给输出函数
+
+        input:  w,              json输出器
+
+        output: w               清空缓冲区的json输出器
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_writer_drain(xjson_writer *w) {
+        if (w->len > 0 && !w->error && w->sink(w->user, w->buf, w->len) != 0) {
+                w->error = xjson_true;
+        }
+        w->len = 0;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_put
+        描述:   向缓冲区写入数据，缓冲区满时先输出，超过缓冲区大小的数据
+                直接交给输出函数
+
+        input:  w,              json输出器
+                s,              数据
+                n,              数据长度
+
+        output: w               写入后的json输出器
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_writer_put(xjson_writer *w, const char *s, size_t n) {
+        if (n > XJSON_WRITER_BUFFER_SIZE - w->len) {
+                xjson_writer_drain(w);
+                if (n >= XJSON_WRITER_BUFFER_SIZE) {
+                        if (!w->error && w->sink(w->user, s, n) != 0) {
+                                w->error = xjson_true;
+                        }
+                        return;
+                }
+        }
+
+        memcpy(w->buf + w->len, s, n);
+        w->len += n;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_separate
+        描述:   输出json对象前的分隔符，array成员之间为','，根对象之间为'\n'
+
+        input:  w,              json输出器
+
+        output: w               写入分隔符后的json输出器
+
+        return: success, None
+                failure, object中缺少key时程序终止
+ *---------------------------------------------------------------------------*/
+static void
+xjson_writer_separate(xjson_writer *w) {
+        if (w->depth == 0) {
+                if (w->roots++ > 0) {
+                        xjson_writer_put(w, "\n", 1);
+                }
+                return;
+        }
+
+        if (w->depth > XJSON_WRITER_MAX_DEPTH) {
+                w->after_key = xjson_false;     // 超过最大层数，w->error已置位
+                return;
+        }
+
+        unsigned char *nest = &w->nest[w->depth - 1];
+        if (*nest & XJSON_WRITER_OBJECT) {
+                assert(w->after_key);
+                w->after_key = xjson_false;
+        } else if (*nest & XJSON_WRITER_MEMBER) {
+                xjson_writer_put(w, ",", 1);
+        } else {
+                *nest |= XJSON_WRITER_MEMBER;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_escape
+        描述:   将字符串转义后写入缓冲区，无需转义的部分整段复制
+
+        input:  w,              json输出器
+                s,              字符串
+                len,            字符串长度
+
+        output: w               写入后的json输出器
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_writer_escape(xjson_writer *w, const char *s, size_t len) {
+        const char *p = s, *end = s + len, *q;
+        char esc[6];
+        int ascii;
+
+        xjson_writer_put(w, "\"", 1);
+        for (;;) {
+                q = xjson_scan_string(p, end, &ascii);
+                if (q != p) {
+                        xjson_writer_put(w, p, q - p);
+                }
+                if (q == end) {
+                        break;
+                }
+                xjson_writer_put(w, esc, xjson_escape_char(*q, esc));
+                p = q + 1;
+        }
+        xjson_writer_put(w, "\"", 1);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_begin
+        描述:   开始一层array或object。超过XJSON_WRITER_MAX_DEPTH层时置
+                w->error，之后不再输出，各层仍须正常结束
+
+        input:  w,              json输出器
+                type,           XJSON_ARRAY || XJSON_OBJECT
+
+        output: w               进入新一层的json输出器
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_writer_begin(xjson_writer *w, xjson_type type) {
+        assert(w != NULL);
+
+        xjson_writer_separate(w);
+        if (w->depth < XJSON_WRITER_MAX_DEPTH) {
+                w->nest[w->depth] = type == XJSON_OBJECT ? XJSON_WRITER_OBJECT : 0;
+        } else {
+                w->error = xjson_true;
+        }
+        w->depth++;
+        xjson_writer_put(w, type == XJSON_OBJECT ? "{" : "[", 1);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_end
+        描述:   结束当前的array或object
+
+        input:  w,              json输出器
+                type,           XJSON_ARRAY || XJSON_OBJECT
+
+        output: w               回到上一层的json输出器
+
+        return: success, None
+                failure, 当前层类型不符或object中key没有对应的值时程序终止
+ *---------------------------------------------------------------------------*/
+static void
+xjson_writer_end(xjson_writer *w, xjson_type type) {
+        assert(w != NULL && w->depth > 0 && !w->after_key);
+        assert(w->depth > XJSON_WRITER_MAX_DEPTH ||
+               !(w->nest[w->depth - 1] & XJSON_WRITER_OBJECT) == (type != XJSON_OBJECT));
+
+        w->depth--;
+        xjson_writer_put(w, type == XJSON_OBJECT ? "}" : "]", 1);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_sink_file
+        描述:   输出至FILE*的输出函数
+
+        input:  user,           FILE*
+                data,           数据
+                len,            数据长度
+
+        output: None
+
+        return: success, 0
+                failure, -1
+ *---------------------------------------------------------------------------*/
+static int
+xjson_sink_file(void *user, const char *data, size_t len) {
+        return fwrite(data, 1, len, (FILE *)user) == len ? 0 : -1;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+/*---------------------------------------------------------------------------*
+        函数名: xjson_sink_fd
+        描述:   输出至文件描述符的输出函数，处理部分写入与EINTR
+
+        input:  user,           xjson_writer.fd的地址
+                data,           数据
+                len,            数据长度
+
+        output: None
+
+        return: success, 0
+                failure, -1
+ *---------------------------------------------------------------------------*/
+static int
+xjson_sink_fd(void *user, const char *data, size_t len) {
+        int fd = *(int *)user;
+
+        while (len > 0) {
+                ssize_t n = write(fd, data, len);
+                if (n < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        return -1;
+                }
+                data += n;
+                len -= n;
+        }
+
+        return 0;
+}
+#endif
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_init
+        描述:   初始化json输出器，输出经固定大小的缓冲区交给输出函数
+
+        input:  w,              json输出器
+                sink,           输出函数，成功时返回0
+                user,           输出函数的第一个参数
+
+        output: w               空的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_init(xjson_writer *w, xjson_sink sink, void *user) {
+        assert(w != NULL && sink != NULL);
+
+        w->sink = sink;
+        w->user = user;
+        w->fd = -1;
+        w->error = xjson_false;
+        w->after_key = xjson_false;
+        w->len = w->depth = w->roots = 0;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_init_file
+        描述:   初始化输出至FILE*的json输出器
+
+        input:  w,              json输出器
+                fp,             已打开的文件
+
+        output: w               空的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_init_file(xjson_writer *w, FILE *fp) {
+        assert(fp != NULL);
+        xjson_writer_init(w, xjson_sink_file, fp);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_init_fd
+        描述:   初始化以write(2)输出至文件描述符的json输出器
+
+        input:  w,              json输出器
+                fd,             文件描述符
+
+        output: w               空的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_init_fd(xjson_writer *w, int fd) {
+        assert(w != NULL && fd >= 0);
+        xjson_writer_init(w, xjson_sink_fd, &w->fd);
+        w->fd = fd;
+}
+#endif
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_flush
+        描述:   将缓冲区中的数据全部交给输出函数
+
+        input:  w,              json输出器
+
+        output: w               清空缓冲区的json输出器
+
+        return: 全部输出成功, xjson_true
+                输出函数曾经失败或嵌套超过XJSON_WRITER_MAX_DEPTH层, xjson_false
+ *---------------------------------------------------------------------------*/
+int
+xjson_writer_flush(xjson_writer *w) {
+        assert(w != NULL);
+
+        xjson_writer_drain(w);
+        return !w->error;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_begin_array
+        描述:   输出'['，开始一个array。嵌套超过XJSON_WRITER_MAX_DEPTH层
+                时不再输出，xjson_writer_flush返回xjson_false
+
+        input:  w,              json输出器
+
+        output: w               进入array的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_begin_array(xjson_writer *w) {
+        xjson_writer_begin(w, XJSON_ARRAY);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_end_array
+        描述:   输出']'，结束当前array
+
+        input:  w,              json输出器
+
+        output: w               回到上一层的json输出器
+
+        return: success, None
+                failure, 当前层不是array时程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_end_array(xjson_writer *w) {
+        xjson_writer_end(w, XJSON_ARRAY);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_begin_object
+        描述:   输出'{'，开始一个object，其成员须以xjson_writer_key开始。
+                嵌套超过XJSON_WRITER_MAX_DEPTH层时同xjson_writer_begin_array
+
+        input:  w,              json输出器
+
+        output: w               进入object的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_begin_object(xjson_writer *w) {
+        xjson_writer_begin(w, XJSON_OBJECT);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_end_object
+        描述:   输出'}'，结束当前object
+
+        input:  w,              json输出器
+
+        output: w               回到上一层的json输出器
+
+        return: success, None
+                failure, 当前层不是object时程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_end_object(xjson_writer *w) {
+        xjson_writer_end(w, XJSON_OBJECT);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_key
+        描述:   输出object成员的key，之后须输出一个值
+
+        input:  w,              json输出器
+                key,            key字符串
+                len,            key字符串长度
+
+        output: w               写入key后的json输出器
+
+        return: success, None
+                failure, 当前层不是object时程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_key(xjson_writer *w, const char *key, size_t len) {
+        assert(w != NULL && (key != NULL || len == 0));
+        assert(w->depth > 0 && !w->after_key);
+
+        if (w->depth > XJSON_WRITER_MAX_DEPTH) {
+                w->after_key = xjson_true;      // 超过最大层数，w->error已置位
+                return;
+        }
+        assert(w->nest[w->depth - 1] & XJSON_WRITER_OBJECT);
+        if (w->nest[w->depth - 1] & XJSON_WRITER_MEMBER) {
+                xjson_writer_put(w, ",", 1);
+        }
+        w->nest[w->depth - 1] |= XJSON_WRITER_MEMBER;
+        xjson_writer_escape(w, key, len);
+        xjson_writer_put(w, ":", 1);
+        w->after_key = xjson_true;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_null
+        描述:   输出null
+
+        input:  w,              json输出器
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_null(xjson_writer *w) {
+        assert(w != NULL);
+
+        xjson_writer_separate(w);
+        xjson_writer_put(w, "null", 4);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_boolean
+        描述:   输出true或false
+
+        input:  w,              json输出器
+                boolean,        xjson_true || xjson_false
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_boolean(xjson_writer *w, int boolean) {
+        assert(w != NULL);
+
+        xjson_writer_separate(w);
+        if (boolean) {
+                xjson_writer_put(w, "true", 4);
+        } else {
+                xjson_writer_put(w, "false", 5);
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_number
+        描述:   输出number，可精确表示的整数直接输出十进制数字，其余输出
+                17位有效数字，inf与nan输出为null
+
+        input:  w,              json输出器
+                number,         双精度浮点型数值
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_number(xjson_writer *w, double number) {
+        char buf[32];
+        assert(w != NULL);
+
+        xjson_writer_separate(w);
+        xjson_writer_put(w, buf, xjson_format_number(number, buf));
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_string
+        描述:   转义并输出string
+
+        input:  w,              json输出器
+                s,              字符串，可以包含'\0'
+                len,            字符串长度
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_string(xjson_writer *w, const char *s, size_t len) {
+        assert(w != NULL && (s != NULL || len == 0));
+
+        xjson_writer_separate(w);
+        xjson_writer_escape(w, s, len);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_raw
+        描述:   原样输出一个已序列化的json值，不做校验
+
+        input:  w,              json输出器
+                json,           json字符串
+                len,            json字符串长度
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_raw(xjson_writer *w, const char *json, size_t len) {
+        assert(w != NULL && (json != NULL || len == 0));
+
+        xjson_writer_separate(w);
+        xjson_writer_put(w, json, len);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_tree
+        描述:   输出json对象，不输出之前的分隔符。array成员间的','直接
+                写入，不占用输出器的嵌套层，任意深度的json对象均可输出
+
+        input:  w,              json输出器
+                v,              json对象
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+static void
+xjson_writer_tree(xjson_writer *w, const xjson_value *v) {
+        const char *literal;
+        char buf[32];
+        size_t len;
+
+        switch (v->type) {
+                case XJSON_NULL:
+                        xjson_writer_put(w, "null", 4);
+                        break;
+                case XJSON_FALSE:
+                        xjson_writer_put(w, "false", 5);
+                        break;
+                case XJSON_TRUE:
+                        xjson_writer_put(w, "true", 4);
+                        break;
+                case XJSON_NUMBER:
+                        if ((literal = xjson_get_number_literal(v, &len)) != NULL) {
+                                xjson_writer_put(w, literal, len);
+                        } else {
+                                xjson_writer_put(w, buf, xjson_format_number(v->u.n.number, buf));
+                        }
+                        break;
+                case XJSON_STRING:
+                        xjson_writer_escape(w, v->u.s.string, v->u.s.length);
+                        break;
+                case XJSON_ARRAY:
+                        xjson_writer_put(w, "[", 1);
+                        for (size_t i = 0; i < v->u.a.size; i++) {
+                                if (i > 0) {
+                                        xjson_writer_put(w, ",", 1);
+                                }
+                                xjson_writer_tree(w, &v->u.a.e[i]);
+                        }
+                        xjson_writer_put(w, "]", 1);
+                        break;
+                default:
+                        assert(0);
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_value
+        描述:   输出json对象，延迟转换的number原样输出原文。嵌套层数不受
+                XJSON_WRITER_MAX_DEPTH限制
+
+        input:  w,              json输出器
+                v,              json对象
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_value(xjson_writer *w, const xjson_value *v) {
+        assert(w != NULL && v != NULL);
+
+        xjson_writer_separate(w);
+        xjson_writer_tree(w, v);
+}
+
+#ifdef XJSON_ENABLE_THREADS
+/* 并行输出的一段array成员，输出至独立的缓冲区 */
+typedef struct {
+        const xjson_value       *v;             // array
+        size_t                  begin, end;     // 成员范围
+        char                    *buf;
+        size_t                  len, cap;
+        int                     error;
+}xjson_stringify_task;
+
+#define XJSON_STRINGIFY_BEGIN   ((size_t)-1)    // 输出'['
+#define XJSON_STRINGIFY_END     ((size_t)-2)    // 输出']'
+
+/* 并行输出的计划，steps按顺序为XJSON_STRINGIFY_BEGIN/END或任务下标 */
+typedef struct {
+        xjson_stringify_task    *tasks;
+        size_t                  ntasks, task_cap;
+        size_t                  *steps;
+        size_t                  nsteps, step_cap;
+        size_t                  target;         // 每个任务的目标大小
+        atomic_size_t           next;           // 下一个待执行的任务
+}xjson_stringify_plan;
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_estimate_size
+        描述:   估计json对象序列化后的大小，只用于划分任务，number按
+                最长的"%.17g"估计
+
+        input:  v,              json对象
+
+        output: None
+
+        return: 估计的字节数
+ *---------------------------------------------------------------------------*/
+static size_t
+xjson_estimate_size(const xjson_value *v) {
+        size_t n;
+
+        switch (v->type) {
+                case XJSON_NUMBER:
+                        return v->u.n.literal != NULL ? v->u.n.length : 24;
+                case XJSON_STRING:
+                        return v->u.s.length + 2;
+                case XJSON_ARRAY:
+                        n = v->u.a.size + 1;
+                        for (size_t i = 0; i < v->u.a.size; i++) {
+                                n += xjson_estimate_size(&v->u.a.e[i]);
+                        }
+                        return n;
+                default:
+                        return 5;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_stringify_step
+        描述:   向计划追加一步
+
+        input:  p,              并行输出的计划
+                step,           XJSON_STRINGIFY_BEGIN || XJSON_STRINGIFY_END ||
+                                任务下标
+
+        output: p               追加后的计划
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_stringify_step(xjson_stringify_plan *p, size_t step) {
+        if (p->nsteps == p->step_cap) {
+                p->step_cap = p->step_cap == 0 ? 16 : p->step_cap * 2;
+                p->steps = (size_t *)realloc(p->steps, p->step_cap * sizeof(size_t));
+        }
+        p->steps[p->nsteps++] = step;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_stringify_range
+        描述:   将一段array成员作为一个任务追加至计划
+
+        input:  p,              并行输出的计划
+                v,              array
+                begin,          起始成员
+                end,            结束成员，不含
+                size,           估计的字节数，用于预留缓冲区
+
+        output: p               追加后的计划
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_stringify_range(xjson_stringify_plan *p, const xjson_value *v, size_t begin, size_t end, size_t size) {
+        if (p->ntasks == p->task_cap) {
+                p->task_cap = p->task_cap == 0 ? 16 : p->task_cap * 2;
+                p->tasks = (xjson_stringify_task *)realloc(p->tasks, p->task_cap * sizeof(xjson_stringify_task));
+        }
+
+        xjson_stringify_task *t = &p->tasks[p->ntasks];
+        t->v = v;
+        t->begin = begin;
+        t->end = end;
+        t->cap = size;
+        t->buf = (char *)malloc(size);
+        t->len = 0;
+        t->error = t->buf == NULL;
+        xjson_stringify_step(p, p->ntasks++);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_stringify_split
+        描述:   将较大的array拆分为任务。超过目标大小的array成员继续拆分，
+                其余相邻成员合并至接近目标大小
+
+        input:  p,              并行输出的计划
+                v,              array，估计大小超过目标大小
+
+        output: p               追加的步骤与任务
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_stringify_split(xjson_stringify_plan *p, const xjson_value *v) {
+        size_t begin = 0, size = 0;
+
+        xjson_stringify_step(p, XJSON_STRINGIFY_BEGIN);
+        for (size_t i = 0; i < v->u.a.size; i++) {
+                const xjson_value *e = &v->u.a.e[i];
+                size_t n = xjson_estimate_size(e) + 1;
+
+                if (e->type == XJSON_ARRAY && e->u.a.size > 0 && n > p->target) {
+                        if (begin < i) {
+                                xjson_stringify_range(p, v, begin, i, size);
+                        }
+                        xjson_stringify_split(p, e);
+                        begin = i + 1;
+                        size = 0;
+                        continue;
+                }
+
+                size += n;
+                if (size >= p->target) {
+                        xjson_stringify_range(p, v, begin, i + 1, size);
+                        begin = i + 1;
+                        size = 0;
+                }
+        }
+        if (begin < v->u.a.size) {
+                xjson_stringify_range(p, v, begin, v->u.a.size, size);
+        }
+        xjson_stringify_step(p, XJSON_STRINGIFY_END);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_sink_task
+        描述:   输出至任务缓冲区的输出函数，空间不足时扩容
+
+        input:  user,           xjson_stringify_task
+                data,           数据
+                len,            数据长度
+
+        output: None
+
+        return: success, 0
+                failure, 内存不足时返回-1
+ *---------------------------------------------------------------------------*/
+static int
+xjson_sink_task(void *user, const char *data, size_t len) {
+        xjson_stringify_task *t = (xjson_stringify_task *)user;
+
+        if (len > t->cap - t->len) {
+                size_t cap = t->cap + (t->cap >> 1);
+                if (cap < t->len + len) {
+                        cap = t->len + len;
+                }
+                char *buf = (char *)realloc(t->buf, cap);
+                if (buf == NULL) {
+                        return -1;
+                }
+                t->buf = buf;
+                t->cap = cap;
+        }
+
+        memcpy(t->buf + t->len, data, len);
+        t->len += len;
+        return 0;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_stringify_run
+        描述:   工作线程依次领取并执行任务。任务中的成员以array内部的状态
+                输出，成员间的','与顺序输出相同，首个成员前不输出','
+
+        input:  arg,            xjson_stringify_plan
+
+        output: arg             各任务的输出
+
+        return: NULL
+ *---------------------------------------------------------------------------*/
+static void *
+xjson_stringify_run(void *arg) {
+        xjson_stringify_plan *p = (xjson_stringify_plan *)arg;
+        xjson_writer w;
+        size_t i;
+
+        while ((i = atomic_fetch_add(&p->next, 1)) < p->ntasks) {
+                xjson_stringify_task *t = &p->tasks[i];
+                if (t->error) {
+                        continue;
+                }
+
+                xjson_writer_init(&w, xjson_sink_task, t);
+                w.nest[w.depth++] = 0;
+                for (size_t k = t->begin; k < t->end; k++) {
+                        xjson_writer_value(&w, &t->v->u.a.e[k]);
+                }
+                t->error = !xjson_writer_flush(&w);
+        }
+
+        return NULL;
+}
+#endif
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_value_parallel
+        描述:   同xjson_writer_value，输出结果逐字节相同。按估计大小将较大
+                的array拆分为若干段成员，由threads个线程分别输出至独立的
+                缓冲区，再按顺序交给输出器，超过输出器缓冲区的段直接交给
+                输出函数。需开启XJSON_ENABLE_THREADS，否则或json较小时
+                顺序输出
+
+        input:  w,              json输出器
+                v,              json对象，输出期间不能修改
+                threads,        线程数，含当前线程
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_writer_value_parallel(xjson_writer *w, const xjson_value *v, unsigned threads) {
+        assert(w != NULL && v != NULL);
+
+#ifdef XJSON_ENABLE_THREADS
+        size_t size = v->type == XJSON_ARRAY && threads > 1 ? xjson_estimate_size(v) : 0;
+        if (size < 2 * XJSON_WRITER_PARALLEL_MIN_BYTES) {
+                xjson_writer_value(w, v);
+                return;
+        }
+
+        xjson_stringify_plan p;
+        memset(&p, 0, sizeof(p));
+        atomic_init(&p.next, 0);
+        p.target = size / (threads * 4);
+        if (p.target < XJSON_WRITER_PARALLEL_MIN_BYTES) {
+                p.target = XJSON_WRITER_PARALLEL_MIN_BYTES;
+        }
+        xjson_stringify_split(&p, v);
+
+        pthread_t *tid = (pthread_t *)malloc(threads * sizeof(pthread_t));
+        int *started = (int *)calloc(threads, sizeof(int));
+        assert(tid != NULL && started != NULL);
+        for (unsigned i = 1; i < threads && i < p.ntasks; i++) {
+                started[i] = pthread_create(&tid[i], NULL, xjson_stringify_run, &p) == 0;
+        }
+        xjson_stringify_run(&p);
+        for (unsigned i = 1; i < threads; i++) {
+                if (started[i]) {
+                        pthread_join(tid[i], NULL);
+                }
+        }
+
+        /* 拆分的array不占用输出器的嵌套层，紧跟'['之后的成员前不输出',' */
+        xjson_writer_separate(w);
+        for (size_t i = 0; i < p.nsteps; i++) {
+                if (p.steps[i] != XJSON_STRINGIFY_END && i > 0 && p.steps[i - 1] != XJSON_STRINGIFY_BEGIN) {
+                        xjson_writer_put(w, ",", 1);
+                }
+                if (p.steps[i] == XJSON_STRINGIFY_BEGIN) {
+                        xjson_writer_put(w, "[", 1);
+                } else if (p.steps[i] == XJSON_STRINGIFY_END) {
+                        xjson_writer_put(w, "]", 1);
+                } else {
+                        xjson_stringify_task *t = &p.tasks[p.steps[i]];
+                        xjson_writer_put(w, t->buf, t->len);
+                        w->error |= t->error;
+                }
+        }
+
+        for (size_t i = 0; i < p.ntasks; i++) {
+                free(p.tasks[i].buf);
+        }
+        free(p.tasks);
+        free(p.steps);
+        free(tid);
+        free(started);
+#else
+        (void)threads;
+        xjson_writer_value(w, v);
+#endif
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_free
+        描述:   释放json对象占用的内存，array对象会递归释放其成员
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_free(xjson_value *v) {
+        assert(v != NULL);
+
+        switch (v->type) {
+                case XJSON_STRING:
+                        free(v->u.s.string);
+                        break;
+                case XJSON_ARRAY:
+                        for (size_t i = 0; i < v->u.a.size; i++) {
+                                xjson_free(&v->u.a.e[i]);
+                        }
+                        free(v->u.a.e);
+                        break;
+                default:
+                        break;
+        }
+
+        v->type = XJSON_NULL;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_move
+        描述:   将src转移至dst，dst原有内容被释放，src被置为null，不分配内存
+
+        input:  dst,            目标json对象，不能是src的成员
+                src,            源json对象
+
+        output: dst             转移后的json对象
+                src             null
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_move(xjson_value *dst, xjson_value *src) {
+        assert(dst != NULL && src != NULL);
+
+        if (dst == src) {
+                return;
+        }
+
+        /* src可能是dst的成员，先取出src再释放dst */
+        xjson_value tmp = *src;
+        src->type = XJSON_NULL;
+        xjson_free(dst);
+        *dst = tmp;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_swap
+        描述:   交换两个json对象，不分配内存
+
+        input:  a,              json对象
+                b,              json对象，a、b不能互为成员
+
+        output: a, b            交换后的json对象
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_swap(xjson_value *a, xjson_value *b) {
+        assert(a != NULL && b != NULL);
+
+        if (a != b) {
+                xjson_value tmp = *a;
+                *a = *b;
+                *b = tmp;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_copy_value
+        描述:   将src深拷贝至未初始化的dst，每个string和array只分配一次
+
+        input:  dst,            目标json对象
+                src,            源json对象
+
+        output: dst             src的副本
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_copy_value(xjson_value *dst, const xjson_value *src) {
+        switch (src->type) {
+                case XJSON_STRING:
+                        dst->u.s.string = (char *)malloc(src->u.s.length + 1);
+                        memcpy(dst->u.s.string, src->u.s.string, src->u.s.length + 1);
+                        dst->u.s.length = src->u.s.length;
+                        break;
+                case XJSON_ARRAY:
+                        dst->u.a.size = dst->u.a.capacity = src->u.a.size;
+                        dst->u.a.e = NULL;
+                        if (src->u.a.size > 0) {
+                                dst->u.a.e = (xjson_value *)malloc(src->u.a.size * sizeof(xjson_value));
+                                for (size_t i = 0; i < src->u.a.size; i++) {
+                                        xjson_copy_value(&dst->u.a.e[i], &src->u.a.e[i]);
+                                }
+                        }
+                        break;
+                case XJSON_NUMBER:
+                        /* 副本不能引用src的原文 */
+                        dst->u.n.number = xjson_get_number(src);
+                        dst->u.n.literal = NULL;
+                        dst->u.n.length = 0;
+                        break;
+                default:
+                        dst->u = src->u;
+                        break;
+        }
+
+        dst->type = src->type;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_copy
+        描述:   将src深拷贝至dst，dst原有内容被释放。延迟转换的number在
+                拷贝时转换，副本不再引用json字符串
+
+        input:  dst,            目标json对象
+                src,            源json对象，可以是dst的成员
+
+        output: dst             src的副本
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_copy(xjson_value *dst, const xjson_value *src) {
+        assert(dst != NULL && src != NULL);
+
+        if (dst == src) {
+                return;
+        }
+
+        /* src可能是dst的成员，先完成拷贝再释放dst */
+        xjson_value tmp;
+        xjson_copy_value(&tmp, src);
+        xjson_free(dst);
+        *dst = tmp;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_type
+        描述:   获取json对象类型
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, XJSON_[TYPE]
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_type
+xjson_get_type(const xjson_value *v) {
+        assert(v != NULL);
+        return v->type;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_boolean
+        描述:   获取json boolean对象的值
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, true || false
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+int
+xjson_get_boolean(const xjson_value *v) {
+        assert(v != NULL &&
+                (v->type == XJSON_TRUE || v->type == XJSON_FALSE));
+        return v->type == XJSON_TRUE;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_boolean
+        描述:   设置json boolean对象的值
+
+        input:  v,              json对象
+                boolean,        设置的值            
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_set_boolean(xjson_value *v, int boolean) {
+        assert(v != NULL);
+        xjson_free(v);
+
+        v->type = boolean ? XJSON_TRUE : XJSON_FALSE;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_number
+        描述:   获取json number对象的值，延迟转换的number在首次访问时
+                转换并缓存，因此首次访问不能与其他访问并发
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 双精度浮点型数值
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+double
+xjson_get_number(const xjson_value *v) {
+        assert(v != NULL && v->type == XJSON_NUMBER);
+
+        if (v->u.n.number != v->u.n.number && v->u.n.literal != NULL) {
+                ((xjson_value *)v)->u.n.number = xjson_convert_number(v->u.n.literal, v->u.n.length);
+        }
+
+        return v->u.n.number;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_number
+        描述:   设置json number对象的值
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_set_number(xjson_value *v, double number) {
+        assert(v != NULL);
+        xjson_free(v);
+
+        v->u.n.number = number;
+        v->u.n.literal = NULL;
+        v->u.n.length = 0;
+        v->type = XJSON_NUMBER;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_number_literal
+        描述:   获取延迟转换的json number对象在json中的原文，可用于原样输出
+
+        input:  v,              json对象
+                length,         可以为NULL
+
+        output: length          原文长度
+
+        return: success, 原文起始位置，不以'\0'结尾；非延迟转换的number返回NULL
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+const char *
+xjson_get_number_literal(const xjson_value *v, size_t *length) {
+        assert(v != NULL && v->type == XJSON_NUMBER);
+
+        if (length != NULL) {
+                *length = v->u.n.length;
+        }
+
+        return v->u.n.literal;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_string
+        描述:   获取json string对象的值
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 返回字符串
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+const char *
+xjson_get_string(const xjson_value *v) {
+        assert(v != NULL && v->type == XJSON_STRING);
+        return v->u.s.string;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_string_length
+        描述:   设置json string对象的长度
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 字符串长度
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t xjson_get_string_length(const xjson_value *v) {
+        assert(v != NULL && v->type == XJSON_STRING);
+        return v->u.s.length;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_string
+        描述:   设置json string对象的值
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_set_string(
+        xjson_value *v,
+        const char *string,
+        size_t length) {
+
+        assert(v != NULL && (string != NULL || length == 0));
+        xjson_free(v);
+
+        v->u.s.string = (char *)malloc(length + 1);
+        memcpy(v->u.s.string, string, length);
+        v->u.s.string[length] = '\0';
+        v->u.s.length = length;
+        v->type = XJSON_STRING;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_array_size
+        描述:   获取json array对象的长度
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 返回json array对象的长度
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t xjson_get_array_size(const xjson_value *v) {
+        assert(v != NULL && v->type == XJSON_ARRAY);
+        return v->u.a.size;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_array_element
+        描述:   根据index，获取json array对象的成员
+
+        input:  v,              json对象
+                index,          索引
+
+        output: None
+
+        return: success, 返回json array对象的成员
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_value *xjson_get_array_element(const xjson_value *v, size_t index) {
+        assert(v != NULL && v->type == XJSON_ARRAY);
+        assert(index < v->u.a.size);
+
+        return &v->u.a.e[index];
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_array
+        描述:   设置json对象为空array，并预分配capacity个成员的空间
+
+        input:  v,              json对象
+                capacity,       预分配的成员个数
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_set_array(xjson_value *v, size_t capacity) {
+        assert(v != NULL);
+        xjson_free(v);
+
+        v->type = XJSON_ARRAY;
+        v->u.a.size = 0;
+        v->u.a.capacity = capacity;
+        v->u.a.e = capacity > 0 ? (xjson_value *)malloc(capacity * sizeof(xjson_value)) : NULL;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_array_capacity
+        描述:   获取json array对象已分配的成员个数
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 成员个数
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t
+xjson_get_array_capacity(const xjson_value *v) {
+        assert(v != NULL && v->type == XJSON_ARRAY);
+        return v->u.a.capacity;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_reserve_array
+        描述:   保证json array对象至少可容纳capacity个成员，已有成员被移动而非复制
+
+        input:  v,              json对象
+                capacity,       成员个数
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_reserve_array(xjson_value *v, size_t capacity) {
+        assert(v != NULL && v->type == XJSON_ARRAY);
+
+        if (v->u.a.capacity < capacity) {
+                v->u.a.capacity = capacity;
+                v->u.a.e = (xjson_value *)realloc(v->u.a.e, capacity * sizeof(xjson_value));
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shrink_array
+        描述:   释放json array对象多余的空间，使capacity等于size
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_shrink_array(xjson_value *v) {
+        assert(v != NULL && v->type == XJSON_ARRAY);
+
+        if (v->u.a.capacity > v->u.a.size) {
+                v->u.a.capacity = v->u.a.size;
+                if (v->u.a.size == 0) {
+                        free(v->u.a.e);
+                        v->u.a.e = NULL;
+                } else {
+                        v->u.a.e = (xjson_value *)realloc(v->u.a.e, v->u.a.size * sizeof(xjson_value));
+                }
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_grow_array
+        描述:   空间不足时按1.5倍扩容，使json array对象可再容纳一个成员
+
+        input:  v,              json对象
+
+        output: None
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_grow_array(xjson_value *v) {
+        size_t capacity = v->u.a.capacity;
+
+        if (v->u.a.size == capacity) {
+                capacity += capacity >> 1;
+                xjson_reserve_array(v, capacity > v->u.a.size ? capacity : v->u.a.size + 4);
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_pushback_array_element
+        描述:   在json array对象末尾追加一个null成员，均摊O(1)
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 新成员
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_value *
+xjson_pushback_array_element(xjson_value *v) {
+        assert(v != NULL && v->type == XJSON_ARRAY);
+
+        xjson_grow_array(v);
+        xjson_value *e = &v->u.a.e[v->u.a.size++];
+        xjson_init(e);
+
+        return e;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_insert_array_element
+        描述:   在json array对象的index处插入一个null成员，其后的成员依次后移
+
+        input:  v,              json对象
+                index,          插入位置，不大于size
+
+        output: None
+
+        return: success, 新成员
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_value *
+xjson_insert_array_element(xjson_value *v, size_t index) {
+        assert(v != NULL && v->type == XJSON_ARRAY && index <= v->u.a.size);
+
+        xjson_grow_array(v);
+        xjson_value *e = &v->u.a.e[index];
+        memmove(e + 1, e, (v->u.a.size - index) * sizeof(xjson_value));
+        v->u.a.size++;
+        xjson_init(e);
+
+        return e;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_erase_array_element
+        描述:   释放json array对象从index开始的count个成员，其后的成员依次前移
+
+        input:  v,              json对象
+                index,          起始位置
+                count,          删除的成员个数
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_erase_array_element(xjson_value *v, size_t index, size_t count) {
+        assert(v != NULL && v->type == XJSON_ARRAY);
+        assert(index <= v->u.a.size && count <= v->u.a.size - index);
+
+        for (size_t i = index; i < index + count; i++) {
+                xjson_free(&v->u.a.e[i]);
+        }
+
+        memmove(&v->u.a.e[index], &v->u.a.e[index + count],
+                (v->u.a.size - index - count) * sizeof(xjson_value));
+        v->u.a.size -= count;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_accessor_create
+        描述:   预编译json路径，之后每次访问不再解析路径字符串。路径形如
+                "/0/2"，""表示根对象
+
+        input:  path,           json路径
+
+        output: None
+
+        return: success, 预编译的路径
+                failure, 路径格式错误时程序终止，超过XJSON_ACCESSOR_MAX_DEPTH
+                         层时返回的路径不指向任何成员
+ *---------------------------------------------------------------------------*/
+xjson_accessor
+xjson_accessor_create(const char *path) {
+        xjson_accessor acc;
+        assert(path != NULL);
+
+        acc.depth = 0;
+        while (*path != '\0') {
+                assert(*path == '/');
+                if (acc.depth == XJSON_ACCESSOR_MAX_DEPTH) {
+                        acc.depth = 1;
+                        acc.index[0] = (size_t)-1;      // 任何array的下标都小于该值
+                        break;
+                }
+                path++;
+                assert(ISDIGIT(*path) && (*path != '0' || !ISDIGIT(path[1])));
+
+                size_t index = 0;
+                for (; ISDIGIT(*path); path++) {
+                        assert(index <= ((size_t)-1 - (*path - '0')) / 10);
+                        index = index * 10 + (*path - '0');
+                }
+                acc.index[acc.depth++] = index;
+        }
+
+        return acc;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_accessor_get
+        描述:   按预编译的路径获取json对象的成员
+
+        input:  acc,            预编译的路径
+                v,              json对象
+
+        output: None
+
+        return: success, 路径指向的成员
+                failure, 路径不存在时返回NULL
+ *---------------------------------------------------------------------------*/
+const xjson_value *
+xjson_accessor_get(const xjson_accessor *acc, const xjson_value *v) {
+        assert(acc != NULL && v != NULL);
+
+        for (size_t i = 0; i < acc->depth; i++) {
+                if (v->type != XJSON_ARRAY || acc->index[i] >= v->u.a.size) {
+                        return NULL;
+                }
+                v = &v->u.a.e[acc->index[i]];
+        }
+
+        return v;
+}
+
+#define HASH_M          0xc6a4a7935bd1e995ULL   // MurmurHash64A的乘数
+#define HASH_SEED       0x9e3779b97f4a7c15ULL
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_bytes
+        描述:   MurmurHash64A，每次处理8字节。未做SIMD分派：hash值会被
+                缓存并跨调用比较，须与xjson_set_kernel选择的实现无关，且
+                string成员多为短字符串，逐8字节处理已不是瓶颈
+
+        input:  p,              数据
+                len,            数据长度
+                seed,           hash种子
+
+        output: None
+
+        return: hash值
+ *---------------------------------------------------------------------------*/
+static uint64_t
+xjson_hash_bytes(const char *p, size_t len, uint64_t seed) {
+        const unsigned char *tail;
+        uint64_t h = seed ^ (len * HASH_M), k;
+
+        for (; len >= 8; p += 8, len -= 8) {
+                memcpy(&k, p, sizeof(k));
+                k *= HASH_M;
+                k ^= k >> 47;
+                k *= HASH_M;
+                h ^= k;
+                h *= HASH_M;
+        }
+
+        tail = (const unsigned char *)p;
+        switch (len) {
+                case 7: h ^= (uint64_t)tail[6] << 48;   /* fall through */
+                case 6: h ^= (uint64_t)tail[5] << 40;   /* fall through */
+                case 5: h ^= (uint64_t)tail[4] << 32;   /* fall through */
+                case 4: h ^= (uint64_t)tail[3] << 24;   /* fall through */
+                case 3: h ^= (uint64_t)tail[2] << 16;   /* fall through */
+                case 2: h ^= (uint64_t)tail[1] << 8;    /* fall through */
+                case 1: h ^= (uint64_t)tail[0];
+                        h *= HASH_M;
+        }
+
+        h ^= h >> 47;
+        h *= HASH_M;
+        h ^= h >> 47;
+
+        return h;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_mix
+        描述:   将x混入hash值h
+
+        input:  h,              hash值
+                x,              混入的数据
+
+        output: None
+
+        return: 新的hash值
+ *---------------------------------------------------------------------------*/
+static uint64_t
+xjson_hash_mix(uint64_t h, uint64_t x) {
+        h = (h ^ x) * HASH_M;
+        return h ^ (h >> 47);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_memo_slot
+        描述:   在hash缓存中查找json对象对应的槽位
+
+        input:  m,              hash缓存，容量不为0
+                v,              json对象
+
+        output: None
+
+        return: v所在的槽位，不存在时为应插入的空槽位
+ *---------------------------------------------------------------------------*/
+static size_t
+xjson_hash_memo_slot(const xjson_hash_memo *m, const xjson_value *v) {
+        size_t i = (size_t)(((uint64_t)(uintptr_t)v * HASH_SEED) >> 32) & (m->size - 1);
+
+        while (m->keys[i] != NULL && m->keys[i] != v) {
+                i = (i + 1) & (m->size - 1);
+        }
+
+        return i;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_memo_insert
+        描述:   记录json对象的hash，负载超过一半时容量翻倍
+
+        input:  m,              hash缓存
+                v,              json对象
+                h,              hash值
+
+        output: m               记录了v的hash缓存
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_hash_memo_insert(xjson_hash_memo *m, const xjson_value *v, uint64_t h) {
+        size_t i;
+
+        if ((m->count + 1) * 2 > m->size) {
+                xjson_hash_memo old = *m;
+
+                m->size = old.size ? old.size * 2 : 64;
+                m->keys = (const xjson_value **)calloc(m->size, sizeof(*m->keys));
+                m->hashes = (uint64_t *)malloc(m->size * sizeof(*m->hashes));
+                for (i = 0; i < old.size; i++) {
+                        if (old.keys[i] != NULL) {
+                                size_t j = xjson_hash_memo_slot(m, old.keys[i]);
+                                m->keys[j] = old.keys[i];
+                                m->hashes[j] = old.hashes[i];
+                        }
+                }
+
+                free(old.keys);
+                free(old.hashes);
+        }
+
+        i = xjson_hash_memo_slot(m, v);
+        if (m->keys[i] == NULL) {
+                m->keys[i] = v;
+                m->count++;
+        }
+        m->hashes[i] = h;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_memo_init
+        描述:   初始化hash缓存
+
+        input:  m,              hash缓存
+
+        output: m               空的hash缓存
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_hash_memo_init(xjson_hash_memo *m) {
+        assert(m != NULL);
+
+        m->keys = NULL;
+        m->hashes = NULL;
+        m->size = m->count = 0;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_memo_clear
+        描述:   清空hash缓存，保留已分配的内存
+
+        input:  m,              hash缓存
+
+        output: m               空的hash缓存
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_hash_memo_clear(xjson_hash_memo *m) {
+        assert(m != NULL);
+
+        if (m->count > 0) {
+                memset(m->keys, 0, m->size * sizeof(*m->keys));
+                m->count = 0;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_memo_free
+        描述:   释放hash缓存
+
+        input:  m,              hash缓存
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_hash_memo_free(xjson_hash_memo *m) {
+        assert(m != NULL);
+
+        free(m->keys);
+        free(m->hashes);
+        xjson_hash_memo_init(m);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_memoized
+        描述:   同xjson_hash，计算过程中查找并记录较大array的hash
+
+        input:  v,              json对象
+                m,              hash缓存，可以为NULL
+
+        output: m               新计算的array hash
+
+        return: success, hash值
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+uint64_t
+xjson_hash_memoized(const xjson_value *v, xjson_hash_memo *m) {
+        assert(v != NULL);
+
+        uint64_t h = HASH_SEED + v->type;
+        int memo = m != NULL && v->type == XJSON_ARRAY && v->u.a.size >= XJSON_HASH_MEMO_MIN_SIZE;
+
+        if (memo && m->count > 0) {
+                size_t i = xjson_hash_memo_slot(m, v);
+                if (m->keys[i] == v) {
+                        return m->hashes[i];
+                }
+        }
+
+        switch (v->type) {
+                case XJSON_NUMBER: {
+                        /* 0.0与-0.0相等，hash也须相同 */
+                        double d = xjson_get_number(v);
+                        if (d == 0.0) d = 0.0;
+                        uint64_t bits;
+                        memcpy(&bits, &d, sizeof(bits));
+                        return xjson_hash_mix(h, bits);
+                }
+                case XJSON_STRING:
+                        return xjson_hash_bytes(v->u.s.string, v->u.s.length, h);
+                case XJSON_ARRAY:
+                        h = xjson_hash_mix(h, v->u.a.size);
+                        for (size_t i = 0; i < v->u.a.size; i++) {
+                                h = xjson_hash_mix(h, xjson_hash_memoized(&v->u.a.e[i], m));
+                        }
+                        h = xjson_hash_mix(h, 0);
+                        if (memo) {
+                                xjson_hash_memo_insert(m, v, h);
+                        }
+                        return h;
+                default:
+                        return xjson_hash_mix(h, 0);
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash
+        描述:   计算json对象的64位结构hash，相等的json对象hash相同
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, hash值
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+uint64_t
+xjson_hash(const xjson_value *v) {
+        return xjson_hash_memoized(v, NULL);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_equal_memoized
+        描述:   同xjson_equal，较大的array先比较hash，hash不同时立即返回
+
+        input:  a,              json对象
+                b,              json对象
+                m,              hash缓存，可以为NULL
+
+        output: m               新计算的array hash
+
+        return: success, xjson_true || xjson_false
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+int
+xjson_equal_memoized(const xjson_value *a, const xjson_value *b, xjson_hash_memo *m) {
+        assert(a != NULL && b != NULL);
+
+        if (a == b) {
+                return xjson_true;
+        }
+
+        if (a->type != b->type) {
+                return xjson_false;
+        }
+
+        switch (a->type) {
+                case XJSON_NUMBER:
+                        return xjson_get_number(a) == xjson_get_number(b);
+                case XJSON_STRING:
+                        return a->u.s.length == b->u.s.length &&
+                                memcmp(a->u.s.string, b->u.s.string, a->u.s.length) == 0;
+                case XJSON_ARRAY:
+                        if (a->u.a.size != b->u.a.size) {
+                                return xjson_false;
+                        }
+                        if (m != NULL && a->u.a.size >= XJSON_HASH_MEMO_MIN_SIZE &&
+                            xjson_hash_memoized(a, m) != xjson_hash_memoized(b, m)) {
+                                return xjson_false;
+                        }
+                        for (size_t i = 0; i < a->u.a.size; i++) {
+                                if (!xjson_equal_memoized(&a->u.a.e[i], &b->u.a.e[i], m)) {
+                                        return xjson_false;
+                                }
+                        }
+                        return xjson_true;
+                default:
+                        return xjson_true;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_equal
+        描述:   比较两个json对象是否相等，类型、长度不同时立即返回
+
+        input:  a,              json对象
+                b,              json对象
+
+        output: None
+
+        return: success, xjson_true || xjson_false
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+int
+xjson_equal(const xjson_value *a, const xjson_value *b) {
+        return xjson_equal_memoized(a, b, NULL);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_merge_patch
+        描述:   按RFC 7396将patch合并至target。json对象不含object，非object
+                的patch按RFC整体替换target，相等时不分配内存
+
+        input:  target,         json对象
+                patch,          merge patch，不能是target的成员
+
+        output: target          合并后的json对象
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void
+xjson_merge_patch(xjson_value *target, const xjson_value *patch) {
+        assert(target != NULL && patch != NULL);
+
+        if (!xjson_equal(target, patch)) {
+                xjson_copy(target, patch);
+        }
+}
+
+enum {
+        XJSON_UNDO_INSERTED,                    // 插入了成员，value为空
+        XJSON_UNDO_REMOVED,                     // 删除了成员，value为旧值
+        XJSON_UNDO_MOVED,                       // move删除了成员，旧值在下一条记录中
+        XJSON_UNDO_REPLACED                     // 替换了成员，value为旧值
+};
+
+/* 已执行操作的逆操作，失败时逆序执行以恢复target */
+typedef struct {
+        int             kind;
+        xjson_accessor  path;                   // 成员的位置，depth为0时为根对象
+        xjson_value     value;
+}xjson_undo;
+
+typedef struct {
+        xjson_undo      *e;
+        size_t          size, capacity;
+}xjson_undo_log;
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_undo_push
+        描述:   记录一个逆操作
+
+        input:  log,            逆操作记录
+                kind,           XJSON_UNDO_*
+                path,           成员的位置
+                value,          旧值，移入记录，可以为NULL
+
+        output: log             新增的记录
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_undo_push(xjson_undo_log *log, int kind, const xjson_accessor *path, xjson_value *value) {
+        if (log->size == log->capacity) {
+                log->capacity = log->capacity == 0 ? 8 : log->capacity + (log->capacity >> 1);
+                log->e = (xjson_undo *)realloc(log->e, log->capacity * sizeof(xjson_undo));
+        }
+
+        xjson_undo *u = &log->e[log->size++];
+        u->kind = kind;
+        u->path = *path;
+        xjson_init(&u->value);
+        if (value != NULL) {
+                xjson_move(&u->value, value);
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_patch_parent
+        描述:   获取路径指向的成员所在的array
+
+        input:  v,              根对象
+                path,           成员的位置，depth大于0
+
+        output: None
+
+        return: success, array
+                failure, 不存在或不是array时返回NULL
+ *---------------------------------------------------------------------------*/
+static xjson_value *
+xjson_patch_parent(xjson_value *v, const xjson_accessor *path) {
+        xjson_accessor parent = *path;
+        parent.depth--;
+
+        v = (xjson_value *)xjson_accessor_get(&parent, v);
+        return v != NULL && v->type == XJSON_ARRAY ? v : NULL;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_undo_all
+        描述:   逆序执行记录的逆操作，将target恢复为应用patch之前的状态
+
+        input:  target,         json对象
+                log,            逆操作记录
+
+        output: target          恢复后的json对象
+                log             插入与替换的新值移入记录
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_undo_all(xjson_value *target, xjson_undo_log *log) {
+        for (size_t i = log->size; i-- > 0;) {
+                xjson_undo *u = &log->e[i];
+                xjson_value *parent = u->path.depth > 0 ? xjson_patch_parent(target, &u->path) : NULL;
+                size_t index = u->path.depth > 0 ? u->path.index[u->path.depth - 1] : 0;
+
+                switch (u->kind) {
+                        case XJSON_UNDO_INSERTED:
+                                xjson_move(&u->value, &parent->u.a.e[index]);
+                                xjson_erase_array_element(parent, index, 1);
+                                break;
+                        case XJSON_UNDO_REMOVED:
+                                xjson_move(xjson_insert_array_element(parent, index), &u->value);
+                                break;
+                        case XJSON_UNDO_MOVED:
+                                /* 下一条记录是同一move的插入，已撤销并取回被移动的值 */
+                                xjson_move(xjson_insert_array_element(parent, index), &log->e[i + 1].value);
+                                break;
+                        case XJSON_UNDO_REPLACED:
+                                xjson_swap(parent != NULL ? &parent->u.a.e[index] : target, &u->value);
+                                break;
+                }
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_patch_parse_path
+        描述:   解析RFC 6901路径，下标只能是十进制整数，末尾可以为"-"
+
+        input:  path,           json路径
+                acc,            解析结果
+                append,         末尾是否为"-"
+
+        output: acc             各层下标，"-"的下标为0
+                append          末尾为"-"时为xjson_true
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PATCH_INVALID_PATH
+ *---------------------------------------------------------------------------*/
+static int
+xjson_patch_parse_path(const char *path, xjson_accessor *acc, int *append) {
+        acc->depth = 0;
+        *append = xjson_false;
+        if (path == NULL) {
+                return XJSON_PATCH_INVALID_PATH;
+        }
+
+        while (*path != '\0') {
+                if (*path != '/' || *append || acc->depth == XJSON_ACCESSOR_MAX_DEPTH) {
+                        return XJSON_PATCH_INVALID_PATH;
+                }
+                path++;
+
+                size_t index = 0;
+                if (*path == '-' && (path[1] == '\0' || path[1] == '/')) {
+                        *append = xjson_true;
+                        path++;
+                } else {
+                        if (!ISDIGIT(*path) || (*path == '0' && ISDIGIT(path[1]))) {
+                                return XJSON_PATCH_INVALID_PATH;
+                        }
+                        for (; ISDIGIT(*path); path++) {
+                                if (index > ((size_t)-1 - (*path - '0')) / 10) {
+                                        return XJSON_PATCH_INVALID_PATH;
+                                }
+                                index = index * 10 + (*path - '0');
+                        }
+                }
+                acc->index[acc->depth++] = index;
+        }
+
+        return XJSON_PARSE_OK;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_patch_add
+        描述:   在路径处插入json对象，路径为根对象时替换整个target
+
+        input:  target,         json对象
+                path,           插入位置
+                append,         插入至array末尾
+                value,          插入的json对象
+                log,            逆操作记录
+
+        output: target          插入后的json对象
+                value           成功时移入target
+                log             新增的逆操作
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PATCH_PATH_NOT_FOUND，target与value不变
+ *---------------------------------------------------------------------------*/
+static int
+xjson_patch_add(xjson_value *target, xjson_accessor *path, int append, xjson_value *value, xjson_undo_log *log) {
+        if (path->depth == 0) {
+                xjson_swap(target, value);
+                xjson_undo_push(log, XJSON_UNDO_REPLACED, path, value);
+                return XJSON_PARSE_OK;
+        }
+
+        xjson_value *parent = xjson_patch_parent(target, path);
+        size_t *index = &path->index[path->depth - 1];
+        if (parent == NULL || (!append && *index > parent->u.a.size)) {
+                return XJSON_PATCH_PATH_NOT_FOUND;
+        }
+        if (append) {
+                *index = parent->u.a.size;
+        }
+
+        xjson_move(xjson_insert_array_element(parent, *index), value);
+        xjson_undo_push(log, XJSON_UNDO_INSERTED, path, NULL);
+        return XJSON_PARSE_OK;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_patch_locate
+        描述:   获取路径指向的已存在成员
+
+        input:  target,         json对象
+                path,           json路径
+                append,         末尾是否为"-"
+
+        output: None
+
+        return: success, 成员
+                failure, 不存在时返回NULL
+ *---------------------------------------------------------------------------*/
+static xjson_value *
+xjson_patch_locate(xjson_value *target, const xjson_accessor *path, int append) {
+        return append ? NULL : (xjson_value *)xjson_accessor_get(path, target);
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_patch_apply_one
+        描述:   执行一个RFC 6902操作，未触及的成员只移动不复制
+
+        input:  target,         json对象
+                op,             操作
+                log,            逆操作记录
+
+        output: target          修改后的json对象
+                log             新增的逆操作
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PATCH_INVALID_PATH ||
+                         XJSON_PATCH_PATH_NOT_FOUND ||
+                         XJSON_PATCH_TEST_FAILED
+ *---------------------------------------------------------------------------*/
+static int
+xjson_patch_apply_one(xjson_value *target, const xjson_patch *op, xjson_undo_log *log) {
+        xjson_accessor path, from;
+        xjson_value tmp, *e, *parent;
+        int append, from_append, ret;
+
+        if ((ret = xjson_patch_parse_path(op->path, &path, &append)) != XJSON_PARSE_OK) {
+                return ret;
+        }
+        if ((op->op == XJSON_PATCH_MOVE || op->op == XJSON_PATCH_COPY) &&
+            (ret = xjson_patch_parse_path(op->from, &from, &from_append)) != XJSON_PARSE_OK) {
+                return ret;
+        }
+
+        xjson_init(&tmp);
+        switch (op->op) {
+                case XJSON_PATCH_ADD:
+                        xjson_copy(&tmp, &op->value);
+                        break;
+
+                case XJSON_PATCH_COPY:
+                        if ((e = xjson_patch_locate(target, &from, from_append)) == NULL) {
+                                return XJSON_PATCH_PATH_NOT_FOUND;
+                        }
+                        xjson_copy(&tmp, e);
+                        break;
+
+                case XJSON_PATCH_MOVE:
+                        /* from不能是path的真前缀，即不能移入自身的成员 */
+                        if (from.depth < path.depth &&
+                            memcmp(from.index, path.index, from.depth * sizeof(size_t)) == 0) {
+                                return XJSON_PATCH_INVALID_PATH;
+                        }
+                        if (from.depth == 0 || xjson_patch_locate(target, &from, from_append) == NULL) {
+                                return XJSON_PATCH_PATH_NOT_FOUND;
+                        }
+                        parent = xjson_patch_parent(target, &from);
+                        xjson_move(&tmp, &parent->u.a.e[from.index[from.depth - 1]]);
+                        xjson_erase_array_element(parent, from.index[from.depth - 1], 1);
+                        xjson_undo_push(log, XJSON_UNDO_MOVED, &from, NULL);
+                        break;
+
+                case XJSON_PATCH_REMOVE:
+                        if (path.depth == 0 || xjson_patch_locate(target, &path, append) == NULL) {
+                                return XJSON_PATCH_PATH_NOT_FOUND;
+                        }
+                        parent = xjson_patch_parent(target, &path);
+                        xjson_move(&tmp, &parent->u.a.e[path.index[path.depth - 1]]);
+                        xjson_erase_array_element(parent, path.index[path.depth - 1], 1);
+                        xjson_undo_push(log, XJSON_UNDO_REMOVED, &path, &tmp);
+                        return XJSON_PARSE_OK;
+
+                case XJSON_PATCH_REPLACE:
+                        if ((e = xjson_patch_locate(target, &path, append)) == NULL) {
+                                return XJSON_PATCH_PATH_NOT_FOUND;
+                        }
+                        xjson_copy(&tmp, &op->value);
+                        xjson_swap(e, &tmp);
+                        xjson_undo_push(log, XJSON_UNDO_REPLACED, &path, &tmp);
+                        return XJSON_PARSE_OK;
+
+                case XJSON_PATCH_TEST:
+                        if ((e = xjson_patch_locate(target, &path, append)) == NULL) {
+                                return XJSON_PATCH_PATH_NOT_FOUND;
+                        }
+                        return xjson_equal(e, &op->value) ? XJSON_PARSE_OK : XJSON_PATCH_TEST_FAILED;
+
+                default:
+                        assert(0 && "invalid patch operation");
+                        return XJSON_PATCH_INVALID_PATH;
+        }
+
+        /* add、copy、move最后插入tmp */
+        if ((ret = xjson_patch_add(target, &path, append, &tmp, log)) != XJSON_PARSE_OK) {
+                if (op->op == XJSON_PATCH_MOVE) {
+                        /* 放回原位并撤销删除的记录 */
+                        parent = xjson_patch_parent(target, &from);
+                        xjson_move(xjson_insert_array_element(parent, from.index[from.depth - 1]), &tmp);
+                        log->size--;
+                } else {
+                        xjson_free(&tmp);
+                }
+        }
+
+        return ret;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_apply_patch
+        描述:   按RFC 6902原地修改json对象，只为新增与替换的值分配内存，
+                其余成员只移动。任一操作失败时撤销已执行的操作
+
+        input:  target,         json对象
+                ops,            操作序列，可以为NULL
+                n,              操作个数
+
+        output: target          成功时为修改后的json对象，失败时不变
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PATCH_INVALID_PATH ||
+                         XJSON_PATCH_PATH_NOT_FOUND ||
+                         XJSON_PATCH_TEST_FAILED
+ *---------------------------------------------------------------------------*/
+int
+xjson_apply_patch(xjson_value *target, const xjson_patch *ops, size_t n) {
+        assert(target != NULL && (ops != NULL || n == 0));
+
+        xjson_undo_log log = { NULL, 0, 0 };
+        int ret = XJSON_PARSE_OK;
+
+        for (size_t i = 0; i < n && ret == XJSON_PARSE_OK; i++) {
+                ret = xjson_patch_apply_one(target, &ops[i], &log);
+        }
+        if (ret != XJSON_PARSE_OK) {
+                xjson_undo_all(target, &log);
+        }
+
+        for (size_t i = 0; i < log.size; i++) {
+                xjson_free(&log.e[i].value);
+        }
+        free(log.e);
+
+        return ret;
+}
+
+/* xjson_diff的状态 */
+typedef struct {
+        xjson_patch     *ops;
+        size_t          size, capacity;
+        char            *path;                  // 当前路径，以'\0'结尾
+        size_t          len, cap;
+        size_t          depth;                  // 当前路径的层数
+        xjson_hash_memo memo;                   // 两个json对象中array的hash
+}xjson_differ;
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_diff_emit
+        描述:   在当前路径处生成一个操作
+
+        input:  d,              diff状态
+                op,             XJSON_PATCH_ADD || XJSON_PATCH_REMOVE ||
+                                XJSON_PATCH_REPLACE
+                v,              操作的值，复制至patch，可以为NULL
+
+        output: d               新增的操作
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_diff_emit(xjson_differ *d, xjson_patch_op op, const xjson_value *v) {
+        if (d->size == d->capacity) {
+                d->capacity = d->capacity == 0 ? 8 : d->capacity + (d->capacity >> 1);
+                d->ops = (xjson_patch *)realloc(d->ops, d->capacity * sizeof(xjson_patch));
+        }
+
+        xjson_patch *p = &d->ops[d->size++];
+        char *path = (char *)malloc(d->len + 1);
+        memcpy(path, d->path, d->len + 1);
+        p->op = op;
+        p->path = path;
+        p->from = NULL;
+        xjson_init(&p->value);
+        if (v != NULL) {
+                xjson_copy(&p->value, v);
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_diff_push_index
+        描述:   当前路径末尾追加一层下标
+
+        input:  d,              diff状态
+                index,          下标
+
+        output: d               追加后的路径
+
+        return: 追加前的路径长度
+ *---------------------------------------------------------------------------*/
+static size_t
+xjson_diff_push_index(xjson_differ *d, size_t index) {
+        size_t len = d->len;
+
+        if (d->len + 32 > d->cap) {
+                d->cap = d->cap * 2 + 32;
+                d->path = (char *)realloc(d->path, d->cap);
+        }
+        d->path[d->len++] = '/';
+        d->len += xjson_format_integer((long long)index, d->path + d->len);
+        d->path[d->len] = '\0';
+        d->depth++;
+
+        return len;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_diff_pop_index
+        描述:   恢复追加下标前的路径
+
+        input:  d,              diff状态
+                len,            xjson_diff_push_index的返回值
+
+        output: d               恢复后的路径
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_diff_pop_index(xjson_differ *d, size_t len) {
+        d->len = len;
+        d->path[len] = '\0';
+        d->depth--;
+}
+
+static void xjson_diff_value(xjson_differ *d, const xjson_value *a, const xjson_value *b);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_diff_gap
+        描述:   将a的一段成员改为b的一段成员。两段中位置相同的成员递归比较，
+                a多出的成员删除，b多出的成员插入
+
+        input:  d,              diff状态，当前路径为array
+                k,              该段在修改中的array中的起始下标
+                a,              a的该段成员
+                m,              a的该段成员个数
+                b,              b的该段成员
+                n,              b的该段成员个数
+
+        output: d               新增的操作
 
-        xjson_init(v);
-        xjson_parse_whitespace(&c);
-        int ret = xjson_parse_value(&c, v);
-        if (ret == XJSON_PARSE_OK) {
-                xjson_parse_whitespace(&c);
-                if (*c.json != '\0') {
-                        v->type = XJSON_NULL;
-                        ret = XJSON_PARSE_ROOT_NOT_SINGULAR;
+        return: 该段之后的成员在修改后的array中的下标
+ *---------------------------------------------------------------------------*/
+static size_t
+xjson_diff_gap(xjson_differ *d, size_t k, const xjson_value *a, size_t m, const xjson_value *b, size_t n) {
+        size_t i, len;
+
+        for (i = 0; i < m && i < n; i++, k++) {
+                len = xjson_diff_push_index(d, k);
+                xjson_diff_value(d, &a[i], &b[i]);
+                xjson_diff_pop_index(d, len);
+        }
+        for (; i < m; i++) {
+                len = xjson_diff_push_index(d, k);
+                xjson_diff_emit(d, XJSON_PATCH_REMOVE, NULL);
+                xjson_diff_pop_index(d, len);
+        }
+        for (; i < n; i++, k++) {
+                len = xjson_diff_push_index(d, k);
+                xjson_diff_emit(d, XJSON_PATCH_ADD, &b[i]);
+                xjson_diff_pop_index(d, len);
+        }
+
+        return k;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_diff_array
+        描述:   比较两个array。先去掉相同的首尾成员，剩余部分按成员hash求
+                编辑距离，相同的成员不变，替换的成员递归比较。剩余部分超过
+                XJSON_DIFF_MAX_CELLS时按位置逐个比较
+
+        input:  d,              diff状态
+                a,              原array
+                b,              目标array
+
+        output: d               新增的操作
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_diff_array(xjson_differ *d, const xjson_value *a, const xjson_value *b) {
+        const xjson_value *ea = a->u.a.e, *eb = b->u.a.e;
+        size_t m = a->u.a.size, n = b->u.a.size, pre = 0;
+
+        while (pre < m && pre < n && xjson_equal_memoized(&ea[pre], &eb[pre], &d->memo)) {
+                pre++;
+        }
+        while (m > pre && n > pre && xjson_equal_memoized(&ea[m - 1], &eb[n - 1], &d->memo)) {
+                m--;
+                n--;
+        }
+        ea += pre;
+        eb += pre;
+        m -= pre;
+        n -= pre;
+
+        if (m == 0 || n == 0 || m > XJSON_DIFF_MAX_CELLS / n) {
+                xjson_diff_gap(d, pre, ea, m, eb, n);
+                return;
+        }
+
+        /* cost[i * (n + 1) + j]为将ea[i..]改为eb[j..]所需的最少操作数，
+           相同的成员不计，替换、删除、插入各计一次 */
+        uint64_t *ha = (uint64_t *)malloc((m + n) * sizeof(uint64_t)), *hb = ha + m;
+        uint32_t *cost = (uint32_t *)malloc((m + 1) * (n + 1) * sizeof(uint32_t));
+        size_t i, j, k = pre, len;
+
+        for (i = 0; i < m; i++) ha[i] = xjson_hash_memoized(&ea[i], &d->memo);
+        for (j = 0; j < n; j++) hb[j] = xjson_hash_memoized(&eb[j], &d->memo);
+
+#define COST(i, j)      cost[(i) * (n + 1) + (j)]
+#define MATCH(i, j)     (ha[i] == hb[j] && xjson_equal_memoized(&ea[i], &eb[j], &d->memo))
+        for (i = m + 1; i-- > 0;) {
+                for (j = n + 1; j-- > 0;) {
+                        if (i == m || j == n) {
+                                COST(i, j) = (uint32_t)(m - i + n - j);
+                        } else if (MATCH(i, j)) {
+                                COST(i, j) = COST(i + 1, j + 1);
+                        } else {
+                                uint32_t c = COST(i + 1, j + 1);
+                                if (c > COST(i + 1, j)) c = COST(i + 1, j);
+                                if (c > COST(i, j + 1)) c = COST(i, j + 1);
+                                COST(i, j) = c + 1;
+                        }
                 }
         }
 
-        assert(c.top == 0);
-        free(c.stack);
+        for (i = j = 0; i < m || j < n;) {
+                len = xjson_diff_push_index(d, k);
+                if (i < m && j < n && COST(i, j) == COST(i + 1, j + 1) && MATCH(i, j)) {
+                        i++, j++, k++;
+                } else if (i < m && j < n && COST(i, j) == COST(i + 1, j + 1) + 1) {
+                        xjson_diff_value(d, &ea[i++], &eb[j++]);
+                        k++;
+                } else if (i < m && COST(i, j) == COST(i + 1, j) + 1) {
+                        xjson_diff_emit(d, XJSON_PATCH_REMOVE, NULL);
+                        i++;
+                } else {
+                        xjson_diff_emit(d, XJSON_PATCH_ADD, &eb[j++]);
+                        k++;
+                }
+                xjson_diff_pop_index(d, len);
+        }
+#undef COST
+#undef MATCH
 
-        return ret;
+        free(cost);
+        free(ha);
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_free
-        描述:   释放(xjson_value *)(v)->u.s.string
+        函数名: xjson_diff_value
+        描述:   比较当前路径处的两个json对象，hash相同的子树直接跳过。
+                当前路径已有XJSON_ACCESSOR_MAX_DEPTH层时不再展开array，
+                整体替换，生成的路径均可由xjson_apply_patch执行
 
-        input:  v,              json对象
+        input:  d,              diff状态
+                a,              原json对象
+                b,              目标json对象
+
+        output: d               新增的操作
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_diff_value(xjson_differ *d, const xjson_value *a, const xjson_value *b) {
+        if (xjson_equal_memoized(a, b, &d->memo)) {
+                return;
+        }
+
+        if (a->type == XJSON_ARRAY && b->type == XJSON_ARRAY && d->depth < XJSON_ACCESSOR_MAX_DEPTH) {
+                xjson_diff_array(d, a, b);
+        } else {
+                xjson_diff_emit(d, XJSON_PATCH_REPLACE, b);
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_diff
+        描述:   生成将a修改为b的RFC 6902操作序列，只包含add、remove与
+                replace。array成员按编辑距离对齐，替换的成员递归比较，相同
+                的子树不展开
+
+        input:  a,              原json对象
+                b,              目标json对象
+                ops,            操作序列
+
+        output: ops             操作序列，由xjson_free_patch释放，无操作时为NULL
+
+        return: success, 操作个数
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t
+xjson_diff(const xjson_value *a, const xjson_value *b, xjson_patch **ops) {
+        assert(a != NULL && b != NULL && ops != NULL);
+
+        xjson_differ d;
+        d.ops = NULL;
+        d.size = d.capacity = 0;
+        d.cap = 64;
+        d.path = (char *)malloc(d.cap);
+        d.path[d.len = 0] = '\0';
+        d.depth = 0;
+        xjson_hash_memo_init(&d.memo);
+
+        xjson_diff_value(&d, a, b);
+
+        xjson_hash_memo_free(&d.memo);
+        free(d.path);
+        *ops = d.ops;
+
+        return d.size;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_free_patch
+        描述:   释放xjson_diff生成的操作序列
+
+        input:  ops,            操作序列，可以为NULL
+                n,              操作个数
 
         output: None
 
@@ -407,93 +6093,173 @@ xjson_parse(xjson_value *v, const char *json) {
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
 void
-xjson_free(xjson_value *v) {
-        assert(v != NULL);
+xjson_free_patch(xjson_patch *ops, size_t n) {
+        assert(ops != NULL || n == 0);
 
-        if (v->type == XJSON_STRING) {
-                free(v->u.s.string);
+        for (size_t i = 0; i < n; i++) {
+                free((char *)ops[i].path);
+                free((char *)ops[i].from);
+                xjson_free(&ops[i].value);
         }
-
-        v->type = XJSON_NULL;
+        free(ops);
 }
 
+/* 不可变的共享json对象 */
+struct xjson_shared_doc {
+        atomic_size_t   refs;
+        xjson_value     root;
+};
+
+/* 发布共享json对象的位置，读者计数按代交替 */
+struct xjson_shared_slot {
+        _Atomic(xjson_shared_doc *)     doc;
+        atomic_size_t                   readers[2];
+        atomic_uint                     epoch;
+        atomic_flag                     writer;
+};
+
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_type
-        描述:   获取json对象类型
+        函数名: xjson_shared_freeze
+        描述:   转换全部延迟转换的number并丢弃原文，使json对象不再引用
+                json字符串，读取时也不再写入
 
         input:  v,              json对象
 
-        output: None
+        output: v               不含延迟转换number的json对象
 
-        return: success, XJSON_[TYPE]
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_shared_freeze(xjson_value *v) {
+        switch (v->type) {
+                case XJSON_NUMBER:
+                        v->u.n.number = xjson_get_number(v);
+                        v->u.n.literal = NULL;
+                        v->u.n.length = 0;
+                        break;
+                case XJSON_ARRAY:
+                        for (size_t i = 0; i < v->u.a.size; i++) {
+                                xjson_shared_freeze(&v->u.a.e[i]);
+                        }
+                        break;
+                default:
+                        break;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shared_create
+        描述:   将json对象转移至新建的共享json对象，引用计数为1
+
+        input:  v,              json对象，须由malloc分配，不能来自
+                                xjson_parse_static或xjson_parse_batch
+
+        output: v               null
+
+        return: success, 共享json对象
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-xjson_type
-xjson_get_type(const xjson_value *v) {
+xjson_shared_doc *
+xjson_shared_create(xjson_value *v) {
         assert(v != NULL);
-        return v->type;
+
+        xjson_shared_doc *d = (xjson_shared_doc *)malloc(sizeof(xjson_shared_doc));
+        assert(d != NULL);
+
+        atomic_init(&d->refs, 1);
+        xjson_init(&d->root);
+        xjson_move(&d->root, v);
+        xjson_shared_freeze(&d->root);
+
+        return d;
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_boolean
-        描述:   获取json boolean对象的值
+        函数名: xjson_shared_retain
+        描述:   增加共享json对象的引用计数，可以并发调用
 
-        input:  v,              json对象
+        input:  d,              共享json对象
 
         output: None
 
-        return: success, true || false
+        return: success, d
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-int
-xjson_get_boolean(const xjson_value *v) {
-        assert(v != NULL &&
-                (v->type == XJSON_TRUE || v->type == XJSON_FALSE));
-        return v->type == XJSON_TRUE;
+xjson_shared_doc *
+xjson_shared_retain(xjson_shared_doc *d) {
+        assert(d != NULL);
+
+        atomic_fetch_add_explicit(&d->refs, 1, memory_order_relaxed);
+        return d;
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_set_boolean
-        描述:   设置json boolean对象的值
+        函数名: xjson_shared_release
+        描述:   减少共享json对象的引用计数，减为0时释放，可以并发调用
 
-        input:  v,              json对象
-                boolean,        设置的值            
+        input:  d,              共享json对象，可以为NULL
 
         output: None
 
-        return: success, None
-                failure, 程序终止
+        return: None
  *---------------------------------------------------------------------------*/
 void
-xjson_set_boolean(xjson_value *v, int boolean) {
-        assert(v != NULL);
-        xjson_free(v);
+xjson_shared_release(xjson_shared_doc *d) {
+        if (d != NULL && atomic_fetch_sub_explicit(&d->refs, 1, memory_order_acq_rel) == 1) {
+                xjson_free(&d->root);
+                free(d);
+        }
+}
 
-        v->type = boolean ? XJSON_TRUE : XJSON_FALSE;
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shared_root
+        描述:   获取共享json对象的根对象。根对象只读，const访问函数(包括
+                xjson_get_number、xjson_equal、xjson_hash)可以并发调用
+
+        input:  d,              共享json对象
+
+        output: None
+
+        return: success, 根对象
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+const xjson_value *
+xjson_shared_root(const xjson_shared_doc *d) {
+        assert(d != NULL);
+        return &d->root;
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_number
-        描述:   获取json number对象的值
+        函数名: xjson_shared_slot_create
+        描述:   新建发布共享json对象的位置
 
-        input:  v,              json对象
+        input:  d,              初始的共享json对象，可以为NULL，其引用转移
+                                至slot
 
         output: None
 
-        return: success, 双精度浮点型数值
+        return: success, slot
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-double
-xjson_get_number(const xjson_value *v) {
-        assert(v != NULL && v->type == XJSON_NUMBER);
-        return v->u.number;
+xjson_shared_slot *
+xjson_shared_slot_create(xjson_shared_doc *d) {
+        xjson_shared_slot *s = (xjson_shared_slot *)malloc(sizeof(xjson_shared_slot));
+        assert(s != NULL);
+
+        atomic_init(&s->doc, d);
+        atomic_init(&s->readers[0], 0);
+        atomic_init(&s->readers[1], 0);
+        atomic_init(&s->epoch, 0);
+        atomic_flag_clear(&s->writer);
+
+        return s;
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_set_number
-        描述:   设置json number对象的值
+        函数名: xjson_shared_slot_free
+        描述:   释放slot及其持有的引用，须在没有读者与写者时调用
 
-        input:  v,              json对象
+        input:  s,              slot
 
         output: None
 
@@ -501,105 +6267,401 @@ xjson_get_number(const xjson_value *v) {
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
 void
-xjson_set_number(xjson_value *v, double number) {
-        assert(v != NULL);
-        xjson_free(v);
+xjson_shared_slot_free(xjson_shared_slot *s) {
+        assert(s != NULL);
 
-        v->u.number = number;
-        v->type = XJSON_NUMBER;
+        xjson_shared_release(atomic_load(&s->doc));
+        free(s);
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_string
-        描述:   获取json string对象的值
+        函数名: xjson_shared_load
+        描述:   获取slot当前发布的共享json对象并增加引用计数，不加锁，
+                与xjson_shared_swap并发调用时返回新版本或旧版本
 
-        input:  v,              json对象
+        input:  s,              slot
 
         output: None
 
-        return: success, 返回字符串
+        return: success, 共享json对象，用完后须xjson_shared_release；
+                         slot为空时返回NULL
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-const char *
-xjson_get_string(const xjson_value *v) {
-        assert(v != NULL && v->type == XJSON_STRING);
-        return v->u.s.string;
+xjson_shared_doc *
+xjson_shared_load(xjson_shared_slot *s) {
+        assert(s != NULL);
+
+        /* 计入当前代后再确认代未改变，之后切换代的写者必然等待本读者 */
+        unsigned epoch;
+        for (;;) {
+                epoch = atomic_load(&s->epoch);
+                atomic_fetch_add(&s->readers[epoch & 1], 1);
+                if (atomic_load(&s->epoch) == epoch) {
+                        break;
+                }
+                atomic_fetch_sub(&s->readers[epoch & 1], 1);
+        }
+        epoch &= 1;
+
+        /* 在读者计数之内读取并引用，写者等待本代读者离开后才返回旧版本 */
+        xjson_shared_doc *d = atomic_load(&s->doc);
+        if (d != NULL) {
+                xjson_shared_retain(d);
+        }
+        atomic_fetch_sub(&s->readers[epoch], 1);
+
+        return d;
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_set_string_length
-        描述:   设置json string对象的长度
+        函数名: xjson_shared_swap
+        描述:   发布新版本的共享json对象(RCU)。读者不被阻塞；写者之间
+                串行，并等待可能读到旧版本的读者完成引用后返回旧版本
 
-        input:  v,              json对象
+        input:  s,              slot
+                d,              新版本，可以为NULL，其引用转移至slot
 
         output: None
 
-        return: success, 字符串长度
+        return: success, 旧版本，由调用者xjson_shared_release；
+                         slot原为空时返回NULL
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-size_t xjson_get_string_length(const xjson_value *v) {
-        assert(v != NULL && v->type == XJSON_STRING);
-        return v->u.s.length;
+xjson_shared_doc *
+xjson_shared_swap(xjson_shared_slot *s, xjson_shared_doc *d) {
+        assert(s != NULL);
+
+        while (atomic_flag_test_and_set(&s->writer)) {
+        }
+
+        xjson_shared_doc *old = atomic_exchange(&s->doc, d);
+
+        /* 之后的读者计入另一代，只需等待本代读者离开 */
+        unsigned epoch = atomic_fetch_add(&s->epoch, 1) & 1;
+        while (atomic_load(&s->readers[epoch]) != 0) {
+        }
+
+        atomic_flag_clear(&s->writer);
+
+        return old;
 }
 
+/* 解析结果缓存的一项，同时位于hash桶链表与LRU链表中 */
+typedef struct xjson_cache_entry xjson_cache_entry;
+struct xjson_cache_entry {
+        uint64_t                hash;
+        char                    *json;          // 输入的副本，命中时逐字节比较
+        size_t                  len;
+        size_t                  bytes;          // 计入内存上限的大小
+        xjson_shared_doc        *doc;
+        xjson_cache_entry       *chain;         // 同一hash桶中的下一项
+        xjson_cache_entry       *prev, *next;   // LRU链表，head为最近使用
+};
+
+struct xjson_cache {
+        xjson_cache_entry       **buckets;
+        size_t                  nbuckets;       // 2的幂
+        xjson_cache_entry       *head, *tail;
+        size_t                  max_entries, max_bytes;
+        xjson_cache_stats       stats;
+#ifdef XJSON_ENABLE_THREADS
+        pthread_mutex_t         lock;
+#endif
+};
+
+#ifdef XJSON_ENABLE_THREADS
+#define CACHE_LOCK(c)           pthread_mutex_lock(&(c)->lock)
+#define CACHE_UNLOCK(c)         pthread_mutex_unlock(&(c)->lock)
+#else
+#define CACHE_LOCK(c)           do { } while(0)
+#define CACHE_UNLOCK(c)         do { } while(0)
+#endif
+
 /*---------------------------------------------------------------------------*
-        函数名: xjson_set_string
-        描述:   设置json string对象的值
+        函数名: xjson_footprint
+        描述:   计算json对象的成员占用的堆内存
 
         input:  v,              json对象
 
         output: None
 
-        return: success, None
+        return: 字节数，不含v本身
+ *---------------------------------------------------------------------------*/
+static size_t
+xjson_footprint(const xjson_value *v) {
+        size_t n = 0;
+
+        switch (v->type) {
+                case XJSON_STRING:
+                        return v->u.s.length + 1;
+                case XJSON_ARRAY:
+                        n = v->u.a.capacity * sizeof(xjson_value);
+                        for (size_t i = 0; i < v->u.a.size; i++) {
+                                n += xjson_footprint(&v->u.a.e[i]);
+                        }
+                        return n;
+                default:
+                        return 0;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_cache_create
+        描述:   创建解析结果缓存，超出任一上限时淘汰最久未使用的项。开启
+                XJSON_ENABLE_THREADS时可以并发使用
+
+        input:  max_entries,    最多缓存的项数，大于0
+                max_bytes,      输入副本与解析结果占用内存的上限，大于0
+
+        output: None
+
+        return: success, 缓存
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-void
-xjson_set_string(
-        xjson_value *v,
-        const char *string,
-        size_t length) {
+xjson_cache *
+xjson_cache_create(size_t max_entries, size_t max_bytes) {
+        assert(max_entries > 0 && max_bytes > 0);
+
+        xjson_cache *c = (xjson_cache *)calloc(1, sizeof(xjson_cache));
+        assert(c != NULL);
+
+        c->nbuckets = 16;
+        c->buckets = (xjson_cache_entry **)calloc(c->nbuckets, sizeof(xjson_cache_entry *));
+        assert(c->buckets != NULL);
+        c->max_entries = max_entries;
+        c->max_bytes = max_bytes;
+#ifdef XJSON_ENABLE_THREADS
+        pthread_mutex_init(&c->lock, NULL);
+#endif
+
+        return c;
+}
 
-        assert(v != NULL && (string != NULL || length == 0));
-        xjson_free(v);
+/*---------------------------------------------------------------------------*
+        函数名: xjson_cache_unlink
+        描述:   将一项移出hash桶与LRU链表并释放，调用者仍持有的共享json
+                对象不受影响
 
-        v->u.s.string = (char *)malloc(length + 1);
-        memcpy(v->u.s.string, string, length);
-        v->u.s.string[length] = '\0';
-        v->u.s.length = length;
-        v->type = XJSON_STRING;
+        input:  c,              缓存
+                e,              缓存项
+
+        output: c               移除后的缓存
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_cache_unlink(xjson_cache *c, xjson_cache_entry *e) {
+        xjson_cache_entry **p = &c->buckets[e->hash & (c->nbuckets - 1)];
+
+        while (*p != e) {
+                p = &(*p)->chain;
+        }
+        *p = e->chain;
+
+        if (e->prev != NULL) e->prev->next = e->next; else c->head = e->next;
+        if (e->next != NULL) e->next->prev = e->prev; else c->tail = e->prev;
+
+        c->stats.entries--;
+        c->stats.bytes -= e->bytes;
+        xjson_shared_release(e->doc);
+        free(e->json);
+        free(e);
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_array_size
-        描述:   获取json array对象的长度
+        函数名: xjson_cache_lookup
+        描述:   查找与输入逐字节相同的项，命中时移至LRU链表头部
 
-        input:  v,              json对象
+        input:  c,              缓存
+                hash,           输入的hash
+                json,           输入
+                len,            输入长度
 
-        output: None
+        output: c               更新后的LRU链表
 
-        return: success, 返回json array对象的长度
+        return: success, 缓存项
+                failure, 未命中时返回NULL
+ *---------------------------------------------------------------------------*/
+static xjson_cache_entry *
+xjson_cache_lookup(xjson_cache *c, uint64_t hash, const char *json, size_t len) {
+        xjson_cache_entry *e = c->buckets[hash & (c->nbuckets - 1)];
+
+        while (e != NULL && (e->hash != hash || e->len != len || memcmp(e->json, json, len) != 0)) {
+                e = e->chain;
+        }
+        if (e != NULL && e != c->head) {
+                e->prev->next = e->next;
+                if (e->next != NULL) e->next->prev = e->prev; else c->tail = e->prev;
+                e->prev = NULL;
+                e->next = c->head;
+                c->head->prev = e;
+                c->head = e;
+        }
+
+        return e;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_cache_insert
+        描述:   在LRU链表头部插入一项，项数超过桶数时扩容，之后淘汰超出
+                上限的项
+
+        input:  c,              缓存
+                e,              新的缓存项
+
+        output: c               插入后的缓存
+
+        return: None
+ *---------------------------------------------------------------------------*/
+static void
+xjson_cache_insert(xjson_cache *c, xjson_cache_entry *e) {
+        if (c->stats.entries >= c->nbuckets) {
+                size_t n = c->nbuckets * 2;
+                xjson_cache_entry **buckets = (xjson_cache_entry **)calloc(n, sizeof(xjson_cache_entry *));
+                assert(buckets != NULL);
+                for (xjson_cache_entry *p = c->head; p != NULL; p = p->next) {
+                        p->chain = buckets[p->hash & (n - 1)];
+                        buckets[p->hash & (n - 1)] = p;
+                }
+                free(c->buckets);
+                c->buckets = buckets;
+                c->nbuckets = n;
+        }
+
+        xjson_cache_entry **bucket = &c->buckets[e->hash & (c->nbuckets - 1)];
+        e->chain = *bucket;
+        *bucket = e;
+        e->prev = NULL;
+        e->next = c->head;
+        if (c->head != NULL) c->head->prev = e; else c->tail = e;
+        c->head = e;
+        c->stats.entries++;
+        c->stats.bytes += e->bytes;
+
+        while (c->stats.entries > c->max_entries || c->stats.bytes > c->max_bytes) {
+                xjson_cache_unlink(c, c->tail);
+                c->stats.evictions++;
+        }
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_cache_parse
+        描述:   解析json并缓存结果。输入按内容hash查找，逐字节相同时直接
+                返回缓存的共享json对象，否则解析并缓存。解析失败的输入不
+                缓存，单项超过内存上限时不缓存
+
+        input:  c,              缓存
+                json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+
+        output: c               更新后的缓存与统计
+
+        return: success, 共享json对象，调用者持有一个引用，须以
+                         xjson_shared_release释放
+                failure, 解析失败时返回NULL
+ *---------------------------------------------------------------------------*/
+xjson_shared_doc *
+xjson_cache_parse(xjson_cache *c, const char *json, size_t len) {
+        assert(c != NULL && (json != NULL || len == 0));
+
+        uint64_t hash = xjson_hash_bytes(json, len, HASH_SEED);
+        xjson_cache_entry *e;
+        xjson_shared_doc *d = NULL;
+
+        CACHE_LOCK(c);
+        if ((e = xjson_cache_lookup(c, hash, json, len)) != NULL) {
+                c->stats.hits++;
+                d = xjson_shared_retain(e->doc);
+        } else {
+                c->stats.misses++;
+        }
+        CACHE_UNLOCK(c);
+        if (d != NULL) {
+                return d;
+        }
+
+        /* 解析期间不持有锁，并发的相同输入可能重复解析 */
+        xjson_parser p;
+        xjson_value v;
+        xjson_parser_init(&p);
+        int ret = xjson_parser_parse(&p, &v, json, len);
+        xjson_parser_free(&p);
+        if (ret != XJSON_PARSE_OK) {
+                return NULL;
+        }
+
+        size_t bytes = sizeof(xjson_cache_entry) + sizeof(xjson_shared_doc) + len + xjson_footprint(&v);
+        d = xjson_shared_create(&v);
+        if (bytes > c->max_bytes) {
+                return d;
+        }
+
+        e = (xjson_cache_entry *)malloc(sizeof(xjson_cache_entry));
+        assert(e != NULL);
+        e->hash = hash;
+        e->json = (char *)malloc(len + 1);
+        assert(e->json != NULL);
+        if (len > 0) {
+                memcpy(e->json, json, len);
+        }
+        e->len = len;
+        e->bytes = bytes;
+        e->doc = xjson_shared_retain(d);
+
+        CACHE_LOCK(c);
+        xjson_cache_entry *old = xjson_cache_lookup(c, hash, json, len);
+        if (old != NULL) {
+                xjson_cache_unlink(c, old);
+        }
+        xjson_cache_insert(c, e);
+        CACHE_UNLOCK(c);
+
+        return d;
+}
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_cache_get_stats
+        描述:   获取缓存的命中、未命中、淘汰次数与当前大小
+
+        input:  c,              缓存
+                stats,          统计
+
+        output: stats           统计的快照
+
+        return: success, None
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-size_t xjson_get_array_size(const xjson_value *v) {
-        assert(v != NULL && v->type == XJSON_ARRAY);
-        return v->u.a.size;
+void
+xjson_cache_get_stats(xjson_cache *c, xjson_cache_stats *stats) {
+        assert(c != NULL && stats != NULL);
+
+        CACHE_LOCK(c);
+        *stats = c->stats;
+        CACHE_UNLOCK(c);
 }
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_array_element
-        描述:   根据index，获取json array对象的成员
+        函数名: xjson_cache_free
+        描述:   释放缓存，调用者仍持有的共享json对象不受影响
 
-        input:  v,              json对象
-                index,          索引
+        input:  c,              缓存，可以为NULL
 
         output: None
 
-        return: success, 返回json array对象的成员
-                failure, 程序终止
+        return: None
  *---------------------------------------------------------------------------*/
-xjson_value *xjson_get_array_element(const xjson_value *v, size_t index) {
-        assert(v != NULL && v->type == XJSON_ARRAY);
-        assert(index < v->u.a.size);
+void
+xjson_cache_free(xjson_cache *c) {
+        if (c == NULL) {
+                return;
+        }
 
-        return &v->u.a.e[index];
+        while (c->head != NULL) {
+                xjson_cache_unlink(c, c->head);
+        }
+#ifdef XJSON_ENABLE_THREADS
+        pthread_mutex_destroy(&c->lock);
+#endif
+        free(c->buckets);
+        free(c);
 }
@@ -2,6 +2,12 @@
 #define XJSON_H_
 
 #include <stddef.h>                     // size_t
+#include <stdint.h>                     // uint64_t
+#include <stdio.h>                      // FILE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 #define xjson_true                      1
 #define xjson_false                     0
@@ -10,6 +16,38 @@
 #define XJSON_PARSE_STACK_INIT_SIZE     256
 #endif
 
+#ifndef XJSON_ARENA_CHUNK_SIZE
+#define XJSON_ARENA_CHUNK_SIZE          65536   // 批量解析结果区每块的最小大小
+#endif
+
+#ifndef XJSON_PREFETCH_BYTES
+#define XJSON_PREFETCH_BYTES            512     // 批量解析时预取下一个json的字节数
+#endif
+
+#ifndef XJSON_WRITER_BUFFER_SIZE
+#define XJSON_WRITER_BUFFER_SIZE        4096    // json输出器缓冲区大小
+#endif
+
+#ifndef XJSON_WRITER_PARALLEL_MIN_BYTES
+#define XJSON_WRITER_PARALLEL_MIN_BYTES 65536   // 并行输出时每段的最小估计大小
+#endif
+
+#ifndef XJSON_WRITER_MAX_DEPTH
+#define XJSON_WRITER_MAX_DEPTH          64      // xjson_writer_begin_*的最大嵌套层数
+#endif
+
+#ifndef XJSON_ACCESSOR_MAX_DEPTH
+#define XJSON_ACCESSOR_MAX_DEPTH        16      // 预编译json路径的最大层数
+#endif
+
+#ifndef XJSON_HASH_MEMO_MIN_SIZE
+#define XJSON_HASH_MEMO_MIN_SIZE        16      // 成员数不少于该值的array才缓存hash
+#endif
+
+#ifndef XJSON_DIFF_MAX_CELLS
+#define XJSON_DIFF_MAX_CELLS            (1 << 20)       // xjson_diff对齐array成员时动态规划表的最大大小
+#endif
+
 typedef enum {
 	XJSON_NULL,
 	XJSON_FALSE,
@@ -25,10 +63,15 @@ struct _xjson_value {
 	xjson_type      type;
 
         union {
-                double number;          // number
+                struct {
+                        double number;          // number，延迟转换且未访问时为NaN
+                        const char *literal;    // 延迟转换时指向json中的原文，否则为NULL
+                        size_t length;          // 原文长度
+                }n;
                 struct {
                         xjson_value *e; // array elements
                         size_t size;    // array count
+                        size_t capacity;// array capacity
                 }a;
                 struct {
                         char *string;   // null-terminated string
@@ -38,6 +81,157 @@ struct _xjson_value {
 
 };
 
+/* SIMD实现的级别，首次解析时按CPU选择，可由环境变量XJSON_KERNEL或xjson_set_kernel指定 */
+typedef enum {
+        XJSON_KERNEL_AUTO = -1,
+        XJSON_KERNEL_SCALAR,                    // SWAR，任意CPU
+        XJSON_KERNEL_SSE42,                     // 16字节
+        XJSON_KERNEL_AVX2,                      // 32字节
+        XJSON_KERNEL_AVX512,                    // 64字节，需AVX-512BW
+        XJSON_KERNEL_COUNT
+} xjson_kernel;
+
+typedef enum {
+        XJSON_PHASE_LITERAL,                    // true/false/null
+        XJSON_PHASE_NUMBER,
+        XJSON_PHASE_STRING,
+        XJSON_PHASE_ARRAY,                      // array成员出栈并复制
+        XJSON_PHASE_TOTAL,
+        XJSON_PHASE_COUNT
+} xjson_phase;
+
+/* 解析统计，定义XJSON_ENABLE_STATS时才统计，定义XJSON_ENABLE_STATS_TIMERS时
+   才计时，时钟默认为rdtsc/clock()，可通过XJSON_STATS_CLOCK()替换 */
+typedef struct {
+        size_t documents;                       // 解析的json字符串个数
+        size_t errors;                          // 解析失败个数
+        size_t bytes;                           // 消耗的json字节数
+        size_t values[XJSON_OBJECT + 1];        // 各类型json对象个数
+        size_t string_bytes_copied;             // 原样复制的字符串字节数
+        size_t string_bytes_escaped;            // 由转义序列解码的字符串字节数
+        size_t stack_peak;                      // 会话栈峰值
+        size_t stack_reallocs;                  // 会话栈扩容次数
+        size_t allocs;                          // string和array分配次数
+        size_t alloc_bytes;                     // string和array分配字节数
+        size_t depth_max;                       // array最大嵌套深度
+        uint64_t cycles[XJSON_PHASE_COUNT];     // 各阶段耗时
+        xjson_kernel kernel;                    // 最近一次解析使用的SIMD实现
+}xjson_stats;
+
+enum {
+        XJSON_PARSER_LAZY_NUMBERS = 1 << 0      // number只校验并记录原文，首次访问时转换
+};
+
+typedef struct {
+        void *chunks;                           // 内存块链表，第一块为当前块
+        char *top, *end;                        // 当前块中的可用空间
+}xjson_arena;
+
+typedef struct {
+        char *stack;                            // 多次解析间复用的会话栈
+        size_t size;
+        unsigned flags;                         // XJSON_PARSER_*，xjson_parser_init后设置
+        unsigned threads;                       // 批量解析的线程数，需开启XJSON_ENABLE_THREADS
+        xjson_arena arena;                      // 批量解析结果共用的内存
+        xjson_stats stats;
+}xjson_parser;
+
+typedef struct {
+        const xjson_value **keys;       // 已缓存hash的array对象
+        uint64_t *hashes;
+        size_t size, count;
+}xjson_hash_memo;
+
+typedef enum {
+        XJSON_FIELD_END = 0,                    // 字段描述表结束标记
+        XJSON_FIELD_BOOLEAN,                    // 1、2、4、8字节整数，true/false
+        XJSON_FIELD_INT,                        // 1、2、4、8字节有符号整数
+        XJSON_FIELD_DOUBLE,                     // float或double
+        XJSON_FIELD_STRING,                     // char[size]，以'\0'结尾
+        XJSON_FIELD_STRUCT                      // 嵌套结构体，对应嵌套array
+}xjson_field_type;
+
+typedef struct xjson_field_desc xjson_field_desc;
+struct xjson_field_desc {
+        size_t offset;                          // 字段在结构体中的偏移
+        xjson_field_type type;
+        size_t size;                            // 字段大小
+        const xjson_field_desc *nested;         // XJSON_FIELD_STRUCT的字段描述表
+};
+
+#define XJSON_FIELD(st, m, t)           { offsetof(st, m), (t), sizeof(((st *)0)->m), NULL }
+#define XJSON_FIELD_NESTED(st, m, d)    { offsetof(st, m), XJSON_FIELD_STRUCT, sizeof(((st *)0)->m), (d) }
+#define XJSON_FIELD_LAST                { 0, XJSON_FIELD_END, 0, NULL }
+
+/* json输出器的输出函数，成功时返回0 */
+typedef int (*xjson_sink)(void *user, const char *data, size_t len);
+
+typedef struct {
+        xjson_sink sink;
+        void *user;                             // 输出函数的第一个参数
+        int fd;                                 // xjson_writer_init_fd的文件描述符
+        int error;                              // 输出函数失败后不再输出
+        int after_key;                          // object中已输出key，等待值
+        size_t len;                             // 缓冲区中待输出的字节数
+        size_t depth;
+        size_t roots;                           // 已输出的根对象个数
+        unsigned char nest[XJSON_WRITER_MAX_DEPTH];
+        char buf[XJSON_WRITER_BUFFER_SIZE];
+}xjson_writer;
+
+typedef struct {
+        size_t depth;
+        size_t index[XJSON_ACCESSOR_MAX_DEPTH]; // 各层array下标
+}xjson_accessor;
+
+/* json对象在文本中的位置，offset相对于父对象的起始位置，编辑后只需平移之后的兄弟 */
+typedef struct xjson_span xjson_span;
+struct xjson_span {
+        size_t offset;
+        size_t length;
+        xjson_span *children;                   // array成员的位置
+        size_t count;
+};
+
+/* 持有文本的json文档，支持增量解析，root与span不可由调用者修改 */
+typedef struct {
+        char *text;
+        size_t length, capacity;
+        xjson_value root;
+        xjson_span span;                        // root的位置，offset为文本中的绝对位置
+}xjson_document;
+
+typedef enum {
+        XJSON_PATCH_ADD,
+        XJSON_PATCH_REMOVE,
+        XJSON_PATCH_REPLACE,
+        XJSON_PATCH_MOVE,
+        XJSON_PATCH_COPY,
+        XJSON_PATCH_TEST
+} xjson_patch_op;
+
+/* RFC 6902的一个操作，路径形如"/0/2"，不超过XJSON_ACCESSOR_MAX_DEPTH层，
+   add、move、copy的目标路径末尾可以为"-" */
+typedef struct {
+        xjson_patch_op op;
+        const char *path;
+        const char *from;                       // move、copy的源路径
+        xjson_value value;                      // add、replace、test的值
+}xjson_patch;
+
+typedef struct xjson_shared_doc xjson_shared_doc;       // 不可变的共享json对象
+typedef struct xjson_shared_slot xjson_shared_slot;     // 发布共享json对象的位置
+
+typedef struct xjson_cache xjson_cache;                 // 以输入内容为键的解析结果缓存
+
+typedef struct {
+        size_t hits;                            // 命中次数
+        size_t misses;                          // 未命中次数，含解析失败
+        size_t evictions;                       // 因超出上限淘汰的项数
+        size_t entries;                         // 当前项数
+        size_t bytes;                           // 当前占用的内存
+}xjson_cache_stats;
+
 enum {
 	XJSON_PARSE_OK = 0,
 
@@ -50,14 +244,28 @@ enum {
         XJSON_PARSE_MISS_QUOTATION_MARK,
         XJSON_PARSE_INVALID_STRING_ESCAPE,
         XJSON_PARSE_INVALID_STRING_CHAR,
-        XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET
+        XJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
+
+        XJSON_PARSE_INVALID_UTF8,               // invalid UTF-8 sequence
+        XJSON_PARSE_INVALID_UNICODE_HEX,
+        XJSON_PARSE_INVALID_UNICODE_SURROGATE,
+
+        XJSON_DECODE_TYPE_MISMATCH,             // token与字段类型不符
+        XJSON_DECODE_COUNT_MISMATCH,            // array成员数与字段数不符
+        XJSON_DECODE_OUT_OF_RANGE,              // 整数或字符串超出字段容量
+
+        XJSON_PARSE_OUT_OF_MEMORY,              // 静态缓冲区空间不足
+
+        XJSON_PATCH_INVALID_PATH,               // 路径格式错误、过深或move移入自身
+        XJSON_PATCH_PATH_NOT_FOUND,             // 路径不存在
+        XJSON_PATCH_TEST_FAILED                 // test操作的值不相等
 };
 
 #define xjson_init(v) do { (v)->type = XJSON_NULL; } while(0)
 
 /*---------------------------------------------------------------------------*
         函数名: xjson_free
-        描述:   释放(xjson_value *)(v)->u.s.string
+        描述:   释放json对象占用的内存，array对象会递归释放其成员
 
         input:  v,              json对象
 
@@ -70,6 +278,50 @@ void xjson_free(xjson_value *v);
 
 #define xjson_set_null(v)       xjson_free(v)
 
+/*---------------------------------------------------------------------------*
+        函数名: xjson_move
+        描述:   将src转移至dst，dst原有内容被释放，src被置为null，不分配内存
+
+        input:  dst,            目标json对象，不能是src的成员
+                src,            源json对象
+
+        output: dst             转移后的json对象
+                src             null
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_move(xjson_value *dst, xjson_value *src);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_swap
+        描述:   交换两个json对象，不分配内存
+
+        input:  a,              json对象
+                b,              json对象，a、b不能互为成员
+
+        output: a, b            交换后的json对象
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_swap(xjson_value *a, xjson_value *b);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_copy
+        描述:   将src深拷贝至dst，dst原有内容被释放。延迟转换的number在
+                拷贝时转换，副本不再引用json字符串
+
+        input:  dst,            目标json对象
+                src,            源json对象，可以是dst的成员
+
+        output: dst             src的副本
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_copy(xjson_value *dst, const xjson_value *src);
+
 /*---------------------------------------------------------------------------*
         函数名: xjson_parse
         描述:   json字符串解析函数
@@ -88,140 +340,1141 @@ void xjson_free(xjson_value *v);
 
                          XJSON_PARSE_INVALID_STRING_ESCAPE ||
                          XJSON_PARSE_INVALID_STRING_CHAR ||
+                         XJSON_PARSE_INVALID_UTF8 ||
+                         XJSON_PARSE_INVALID_UNICODE_HEX ||
+                         XJSON_PARSE_INVALID_UNICODE_SURROGATE ||
                          XJSON_PARSE_MISS_QUOTATION_MARK
  *---------------------------------------------------------------------------*/
 int xjson_parse(xjson_value *v, const char *json);
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_type
-        描述:   获取json对象类型
+        函数名: xjson_parser_init
+        描述:   初始化可复用的json解析器
 
-        input:  v,              json对象
+        input:  p,              json解析器
+
+        output: p               空的json解析器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_parser_init(xjson_parser *p);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parser_free
+        描述:   释放json解析器，包括批量解析的全部结果
+
+        input:  p,              json解析器
 
         output: None
 
-        return: success, XJSON_[TYPE]
+        return: success, None
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-xjson_type xjson_get_type(const xjson_value *v);
+void xjson_parser_free(xjson_parser *p);
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_boolean
-        描述:   获取json boolean对象的值
+        函数名: xjson_parser_parse
+        描述:   使用json解析器解析json字符串，会话栈在多次解析间复用，
+                开启XJSON_ENABLE_STATS时累计解析统计
 
-        input:  v,              json对象
+        input:  p,              json解析器
+                v,              json对象，用于存储json解析结果
+                json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+
+        output: v               json解析结果
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int xjson_parser_parse(xjson_parser *p, xjson_value *v, const char *json, size_t len);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parser_get_stats
+        描述:   获取json解析器累计的解析统计，未开启XJSON_ENABLE_STATS时全为0
+
+        input:  p,              json解析器
 
         output: None
 
-        return: success, true || false
+        return: success, 解析统计
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-int xjson_get_boolean(const xjson_value *v);
+const xjson_stats *xjson_parser_get_stats(const xjson_parser *p);
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_set_boolean
-        描述:   设置json boolean对象的值
+        函数名: xjson_parser_reset_stats
+        描述:   清零json解析器累计的解析统计
 
-        input:  v,              json对象
-                boolean,        设置的值            
+        input:  p,              json解析器
 
         output: None
 
         return: success, None
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-void xjson_set_boolean(xjson_value *v, int boolean);
+void xjson_parser_reset_stats(xjson_parser *p);
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_number
-        描述:   获取json number对象的值
+        函数名: xjson_get_kernel
+        描述:   获取当前使用的SIMD实现，首次调用时检测CPU
 
-        input:  v,              json对象
+        input:  None
 
         output: None
 
-        return: success, 双精度浮点型数值
-                failure, 程序终止
+        return: SIMD实现
  *---------------------------------------------------------------------------*/
-double xjson_get_number(const xjson_value *v);
+xjson_kernel xjson_get_kernel(void);
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_set_number
-        描述:   设置json number对象的值
+        函数名: xjson_set_kernel
+        描述:   指定使用的SIMD实现，用于测试与对比。不应与解析并发调用
 
-        input:  v,              json对象
+        input:  k,              SIMD实现，XJSON_KERNEL_AUTO表示重新检测
+
+        output: None
+
+        return: success, xjson_true
+                failure, 当前CPU不支持时返回xjson_false，保持原实现
+ *---------------------------------------------------------------------------*/
+int xjson_set_kernel(xjson_kernel k);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_kernel_name
+        描述:   获取SIMD实现的名称，即环境变量XJSON_KERNEL的取值
+
+        input:  k,              SIMD实现
 
         output: None
 
+        return: success, 名称
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+const char *xjson_get_kernel_name(xjson_kernel k);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_batch
+        描述:   使用json解析器批量解析多个json字符串，共用一个会话栈，结果
+                分配在解析器的结果区中，解析当前json时预取下一个json。
+                threads大于1且开启XJSON_ENABLE_THREADS时分段并行解析
+
+        input:  p,              json解析器
+                docs,           json字符串，无需以'\0'结尾
+                lens,           json字符串长度
+                n,              json字符串个数
+                out,            json对象，用于存储json解析结果
+                status,         用于存储各json的解析结果，可以为NULL
+
+        output: out             json解析结果，不能调用xjson_free或修改函数，
+                                由xjson_parser_free_batch统一释放
+                status          同xjson_parse
+
+        return: success, 解析成功的json个数
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t xjson_parse_batch(xjson_parser *p, const char *const docs[], const size_t lens[], size_t n,
+                xjson_value out[], int status[]);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parser_free_batch
+        描述:   释放xjson_parse_batch的全部解析结果，保留当前内存块供复用
+
+        input:  p,              json解析器
+
+        output: p               清空结果区的json解析器
+
         return: success, None
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-void xjson_set_number(xjson_value *v, double number);
+void xjson_parser_free_batch(xjson_parser *p);
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_string
-        描述:   获取json string对象的值
+        函数名: xjson_validate
+        描述:   只校验json字符串，不构建json对象，也不分配内存
+
+        input:  json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+                offset,         可以为NULL
+
+        output: offset          成功时为len，失败时为检测到错误的位置
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int xjson_validate(const char *json, size_t len, size_t *offset);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_required_size
+        描述:   计算xjson_parse_static解析json字符串所需的缓冲区大小，
+                只校验一遍json字符串，不分配内存
+
+        input:  json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+                size,           用于存储缓冲区大小
+
+        output: size            成功时为所需的缓冲区大小
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int xjson_required_size(const char *json, size_t len, size_t *size);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_static
+        描述:   在调用者提供的缓冲区中解析json字符串，不使用malloc。会话栈
+                自缓冲区低地址向上增长，json对象与字符串自高地址向下分配
+
+        input:  v,              json对象，用于存储json解析结果
+                json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+                buf,            缓冲区，须按double对齐，cap为0时可以为NULL
+                cap,            缓冲区大小，xjson_required_size的结果即足够
+
+        output: v               json解析结果，其内存全部位于buf中，不能调用
+                                xjson_free或修改函数，buf释放后即失效
+
+        return: success, XJSON_PARSE_OK
+                failure, 同xjson_parse ||
+                         XJSON_PARSE_OUT_OF_MEMORY
+ *---------------------------------------------------------------------------*/
+int xjson_parse_static(xjson_value *v, const char *json, size_t len, void *buf, size_t cap);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_parse_projected
+        描述:   只解析投影路径选中的部分。路径形如"/0/2"，下标"*"选中
+                array全部成员，""选中整个json。未选中的成员置为null以保留
+                下标，其内容只检查string闭合与括号配对，不解析也不解码
 
         input:  v,              json对象
+                json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+                paths,          投影路径，可以为NULL
+                n,              投影路径个数
+
+        output: v               解析结果，失败时为null
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int xjson_parse_projected(xjson_value *v, const char *json, size_t len, const char *const paths[], size_t n);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_document_init
+        描述:   复制json字符串并解析，记录各json对象的位置供增量解析
+
+        input:  d,              json文档
+                json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+
+        output: d               json文档，解析失败时根对象为null
+
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int xjson_document_init(xjson_document *d, const char *json, size_t len);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_document_free
+        描述:   释放json文档
+
+        input:  d,              json文档
 
         output: None
 
-        return: success, 字符串
+        return: success, None
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-const char* xjson_get_string(const xjson_value *v);
+void xjson_document_free(xjson_document *d);
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_set_string_length
-        描述:   设置json string对象的长度
+        函数名: xjson_reparse
+        描述:   修改json文档的文本并增量解析。只重新解析严格包含编辑区域
+                的最小array，其余json对象保持不变，之后对象的位置随之平移；
+                不存在这样的array或其不再是恰好一个array时解析整个文本
 
-        input:  v,              json对象
+        input:  d,              json文档
+                offset,         编辑起始位置
+                removed,        删除的长度
+                inserted,       插入的文本，可以为NULL
+                len,            插入的文本长度
 
-        output: None
+        output: d               修改后的文本与解析结果，失败时根对象为null
 
-        return: success, 字符串长度
+        return: 同xjson_parse
+ *---------------------------------------------------------------------------*/
+int xjson_reparse(xjson_document *d, size_t offset, size_t removed, const char *inserted, size_t len);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_decode_struct
+        描述:   按字段描述表将json array直接解码至结构体，不构建json对象。
+                array成员按位置对应字段，null将字段清零
+
+        input:  json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+                desc,           字段描述表，以XJSON_FIELD_LAST结束
+                out,            结构体地址
+
+        output: out             解码结果，失败时部分字段可能已被写入
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PARSE_*错误 ||
+                         XJSON_DECODE_TYPE_MISMATCH ||
+                         XJSON_DECODE_COUNT_MISMATCH ||
+                         XJSON_DECODE_OUT_OF_RANGE
+ *---------------------------------------------------------------------------*/
+int xjson_decode_struct(const char *json, size_t len, const xjson_field_desc *desc, void *out);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_encode_struct
+        描述:   按字段描述表将结构体编码为json array，与xjson_decode_struct互逆
+
+        input:  in,             结构体地址
+                desc,           字段描述表，以XJSON_FIELD_LAST结束
+                buf,            输出缓冲区，可以为NULL
+                cap,            输出缓冲区大小
+
+        output: buf             json字符串，cap大于0时总以'\0'结尾，
+                                空间不足时被截断
+
+        return: success, 完整json字符串的长度，不含'\0'
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-size_t xjson_get_string_length(const xjson_value *v);
+size_t xjson_encode_struct(const void *in, const xjson_field_desc *desc, char *buf, size_t cap);
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_set_string
-        描述:   设置json string对象的值
+        函数名: xjson_writer_init
+        描述:   初始化json输出器，输出经固定大小的缓冲区交给输出函数
 
-        input:  v,              json对象
+        input:  w,              json输出器
+                sink,           输出函数，成功时返回0
+                user,           输出函数的第一个参数
 
-        output: None
+        output: w               空的json输出器
 
         return: success, None
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-void xjson_set_string(xjson_value *v, const char *string, size_t length);
+void xjson_writer_init(xjson_writer *w, xjson_sink sink, void *user);
 
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_array_size
-        描述:   获取json array对象的长度
+        函数名: xjson_writer_init_file
+        描述:   初始化输出至FILE*的json输出器
 
-        input:  v,              json对象
+        input:  w,              json输出器
+                fp,             已打开的文件
 
-        output: None
+        output: w               空的json输出器
 
-        return: success, 返回json array对象的长度
+        return: success, None
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-size_t xjson_get_array_size(const xjson_value *v);
+void xjson_writer_init_file(xjson_writer *w, FILE *fp);
 
+#if defined(__unix__) || defined(__APPLE__)
 /*---------------------------------------------------------------------------*
-        函数名: xjson_get_array_element
-        描述:   根据index，获取json array对象的成员
+        函数名: xjson_writer_init_fd
+        描述:   初始化以write(2)输出至文件描述符的json输出器
 
-        input:  v,              json对象
-                index,          索引
+        input:  w,              json输出器
+                fd,             文件描述符
 
-        output: None
+        output: w               空的json输出器
 
-        return: success, 返回json array对象的成员
+        return: success, None
                 failure, 程序终止
  *---------------------------------------------------------------------------*/
-xjson_value *xjson_get_array_element(const xjson_value *v, size_t index);
+void xjson_writer_init_fd(xjson_writer *w, int fd);
+#endif
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_flush
+        描述:   将缓冲区中的数据全部交给输出函数
+
+        input:  w,              json输出器
+
+        output: w               清空缓冲区的json输出器
+
+        return: 全部输出成功, xjson_true
+                输出函数曾经失败或嵌套超过XJSON_WRITER_MAX_DEPTH层, xjson_false
+ *---------------------------------------------------------------------------*/
+int xjson_writer_flush(xjson_writer *w);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_begin_array
+        描述:   输出'['，开始一个array。嵌套超过XJSON_WRITER_MAX_DEPTH层
+                时不再输出，xjson_writer_flush返回xjson_false
+
+        input:  w,              json输出器
+
+        output: w               进入array的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_begin_array(xjson_writer *w);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_end_array
+        描述:   输出']'，结束当前array
+
+        input:  w,              json输出器
+
+        output: w               回到上一层的json输出器
+
+        return: success, None
+                failure, 当前层不是array时程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_end_array(xjson_writer *w);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_begin_object
+        描述:   输出'{'，开始一个object，其成员须以xjson_writer_key开始。
+                嵌套超过XJSON_WRITER_MAX_DEPTH层时同xjson_writer_begin_array
+
+        input:  w,              json输出器
+
+        output: w               进入object的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_begin_object(xjson_writer *w);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_end_object
+        描述:   输出'}'，结束当前object
+
+        input:  w,              json输出器
+
+        output: w               回到上一层的json输出器
+
+        return: success, None
+                failure, 当前层不是object时程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_end_object(xjson_writer *w);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_key
+        描述:   输出object成员的key，之后须输出一个值
+
+        input:  w,              json输出器
+                key,            key字符串
+                len,            key字符串长度
+
+        output: w               写入key后的json输出器
+
+        return: success, None
+                failure, 当前层不是object时程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_key(xjson_writer *w, const char *key, size_t len);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_null
+        描述:   输出null
+
+        input:  w,              json输出器
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_null(xjson_writer *w);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_boolean
+        描述:   输出true或false
+
+        input:  w,              json输出器
+                boolean,        xjson_true || xjson_false
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_boolean(xjson_writer *w, int boolean);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_number
+        描述:   输出number，可精确表示的整数直接输出十进制数字，其余输出
+                17位有效数字，inf与nan输出为null
+
+        input:  w,              json输出器
+                number,         双精度浮点型数值
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_number(xjson_writer *w, double number);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_string
+        描述:   转义并输出string
+
+        input:  w,              json输出器
+                s,              字符串，可以包含'\0'
+                len,            字符串长度
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_string(xjson_writer *w, const char *s, size_t len);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_raw
+        描述:   原样输出一个已序列化的json值，不做校验
+
+        input:  w,              json输出器
+                json,           json字符串
+                len,            json字符串长度
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_raw(xjson_writer *w, const char *json, size_t len);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_value
+        描述:   输出json对象，延迟转换的number原样输出原文。嵌套层数不受
+                XJSON_WRITER_MAX_DEPTH限制
+
+        input:  w,              json输出器
+                v,              json对象
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_value(xjson_writer *w, const xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_writer_value_parallel
+        描述:   同xjson_writer_value，输出结果逐字节相同。按估计大小将较大
+                的array拆分为若干段成员，由threads个线程分别输出至独立的
+                缓冲区，再按顺序交给输出器，超过输出器缓冲区的段直接交给
+                输出函数。需开启XJSON_ENABLE_THREADS，否则或json较小时
+                顺序输出
+
+        input:  w,              json输出器
+                v,              json对象，输出期间不能修改
+                threads,        线程数，含当前线程
+
+        output: w               写入后的json输出器
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_writer_value_parallel(xjson_writer *w, const xjson_value *v, unsigned threads);
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_type
+        描述:   获取json对象类型
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, XJSON_[TYPE]
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_type xjson_get_type(const xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_boolean
+        描述:   获取json boolean对象的值
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, true || false
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+int xjson_get_boolean(const xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_boolean
+        描述:   设置json boolean对象的值
+
+        input:  v,              json对象
+                boolean,        设置的值            
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_set_boolean(xjson_value *v, int boolean);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_number
+        描述:   获取json number对象的值，延迟转换的number在首次访问时
+                转换并缓存，因此首次访问不能与其他访问并发
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 双精度浮点型数值
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+double xjson_get_number(const xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_number
+        描述:   设置json number对象的值
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_set_number(xjson_value *v, double number);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_number_literal
+        描述:   获取延迟转换的json number对象在json中的原文，可用于原样输出
+
+        input:  v,              json对象
+                length,         可以为NULL
+
+        output: length          原文长度
+
+        return: success, 原文起始位置，不以'\0'结尾；非延迟转换的number返回NULL
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+const char *xjson_get_number_literal(const xjson_value *v, size_t *length);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_string
+        描述:   获取json string对象的值
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 字符串
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+const char* xjson_get_string(const xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_string_length
+        描述:   设置json string对象的长度
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 字符串长度
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t xjson_get_string_length(const xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_string
+        描述:   设置json string对象的值
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_set_string(xjson_value *v, const char *string, size_t length);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_array_size
+        描述:   获取json array对象的长度
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 返回json array对象的长度
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t xjson_get_array_size(const xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_array_element
+        描述:   根据index，获取json array对象的成员
+
+        input:  v,              json对象
+                index,          索引
+
+        output: None
+
+        return: success, 返回json array对象的成员
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_value *xjson_get_array_element(const xjson_value *v, size_t index);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_set_array
+        描述:   设置json对象为空array，并预分配capacity个成员的空间
+
+        input:  v,              json对象
+                capacity,       预分配的成员个数
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_set_array(xjson_value *v, size_t capacity);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_get_array_capacity
+        描述:   获取json array对象已分配的成员个数
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 成员个数
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t xjson_get_array_capacity(const xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_reserve_array
+        描述:   保证json array对象至少可容纳capacity个成员，已有成员被移动而非复制
+
+        input:  v,              json对象
+                capacity,       成员个数
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_reserve_array(xjson_value *v, size_t capacity);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shrink_array
+        描述:   释放json array对象多余的空间，使capacity等于size
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_shrink_array(xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_pushback_array_element
+        描述:   在json array对象末尾追加一个null成员，均摊O(1)
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, 新成员
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_value *xjson_pushback_array_element(xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_insert_array_element
+        描述:   在json array对象的index处插入一个null成员，其后的成员依次后移
+
+        input:  v,              json对象
+                index,          插入位置，不大于size
+
+        output: None
+
+        return: success, 新成员
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_value *xjson_insert_array_element(xjson_value *v, size_t index);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_erase_array_element
+        描述:   释放json array对象从index开始的count个成员，其后的成员依次前移
+
+        input:  v,              json对象
+                index,          起始位置
+                count,          删除的成员个数
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_erase_array_element(xjson_value *v, size_t index, size_t count);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_accessor_create
+        描述:   预编译json路径，之后每次访问不再解析路径字符串。路径形如
+                "/0/2"，""表示根对象
+
+        input:  path,           json路径
+
+        output: None
+
+        return: success, 预编译的路径
+                failure, 路径格式错误时程序终止，超过XJSON_ACCESSOR_MAX_DEPTH
+                         层时返回的路径不指向任何成员
+ *---------------------------------------------------------------------------*/
+xjson_accessor xjson_accessor_create(const char *path);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_accessor_get
+        描述:   按预编译的路径获取json对象的成员
+
+        input:  acc,            预编译的路径
+                v,              json对象
+
+        output: None
+
+        return: success, 路径指向的成员
+                failure, 路径不存在时返回NULL
+ *---------------------------------------------------------------------------*/
+const xjson_value *xjson_accessor_get(const xjson_accessor *acc, const xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash
+        描述:   计算json对象的64位结构hash，相等的json对象hash相同。
+                hash只用于进程内比较，不同平台的结果可能不同
+
+        input:  v,              json对象
+
+        output: None
+
+        return: success, hash值
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+uint64_t xjson_hash(const xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_equal
+        描述:   比较两个json对象是否相等，类型、长度不同时立即返回
+
+        input:  a,              json对象
+                b,              json对象
+
+        output: None
+
+        return: success, xjson_true || xjson_false
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+int xjson_equal(const xjson_value *a, const xjson_value *b);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_memo_init
+        描述:   初始化hash缓存。缓存以对象地址为键，记录较大array的hash，
+                对应的json对象被修改或释放后须调用xjson_hash_memo_clear
+
+        input:  m,              hash缓存
+
+        output: m               空的hash缓存
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_hash_memo_init(xjson_hash_memo *m);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_memo_clear
+        描述:   清空hash缓存，保留已分配的内存
+
+        input:  m,              hash缓存
+
+        output: m               空的hash缓存
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_hash_memo_clear(xjson_hash_memo *m);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_memo_free
+        描述:   释放hash缓存
+
+        input:  m,              hash缓存
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_hash_memo_free(xjson_hash_memo *m);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_hash_memoized
+        描述:   同xjson_hash，计算过程中查找并记录较大array的hash
+
+        input:  v,              json对象
+                m,              hash缓存，可以为NULL
+
+        output: m               新计算的array hash
+
+        return: success, hash值
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+uint64_t xjson_hash_memoized(const xjson_value *v, xjson_hash_memo *m);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_equal_memoized
+        描述:   同xjson_equal，较大的array先比较hash，hash不同时立即返回
+
+        input:  a,              json对象
+                b,              json对象
+                m,              hash缓存，可以为NULL
+
+        output: m               新计算的array hash
+
+        return: success, xjson_true || xjson_false
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+int xjson_equal_memoized(const xjson_value *a, const xjson_value *b, xjson_hash_memo *m);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_merge_patch
+        描述:   按RFC 7396将patch合并至target。json对象不含object，非object
+                的patch按RFC整体替换target，相等时不分配内存
+
+        input:  target,         json对象
+                patch,          merge patch，不能是target的成员
+
+        output: target          合并后的json对象
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_merge_patch(xjson_value *target, const xjson_value *patch);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_apply_patch
+        描述:   按RFC 6902原地修改json对象，只为新增与替换的值分配内存，
+                其余成员只移动。任一操作失败时撤销已执行的操作
+
+        input:  target,         json对象
+                ops,            操作序列，可以为NULL
+                n,              操作个数
+
+        output: target          成功时为修改后的json对象，失败时不变
+
+        return: success, XJSON_PARSE_OK
+                failure, XJSON_PATCH_INVALID_PATH ||
+                         XJSON_PATCH_PATH_NOT_FOUND ||
+                         XJSON_PATCH_TEST_FAILED
+ *---------------------------------------------------------------------------*/
+int xjson_apply_patch(xjson_value *target, const xjson_patch *ops, size_t n);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_diff
+        描述:   生成将a修改为b的RFC 6902操作序列，只包含add、remove与
+                replace。array成员按编辑距离对齐，替换的成员递归比较，相同
+                的子树不展开
+
+        input:  a,              原json对象
+                b,              目标json对象
+                ops,            操作序列
+
+        output: ops             操作序列，由xjson_free_patch释放，无操作时为NULL
+
+        return: success, 操作个数
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+size_t xjson_diff(const xjson_value *a, const xjson_value *b, xjson_patch **ops);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_free_patch
+        描述:   释放xjson_diff生成的操作序列
+
+        input:  ops,            操作序列，可以为NULL
+                n,              操作个数
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_free_patch(xjson_patch *ops, size_t n);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shared_create
+        描述:   将json对象转移至新建的共享json对象，引用计数为1
+
+        input:  v,              json对象，须由malloc分配，不能来自
+                                xjson_parse_static或xjson_parse_batch
+
+        output: v               null
+
+        return: success, 共享json对象
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_shared_doc *xjson_shared_create(xjson_value *v);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shared_retain
+        描述:   增加共享json对象的引用计数，可以并发调用
+
+        input:  d,              共享json对象
+
+        output: None
+
+        return: success, d
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_shared_doc *xjson_shared_retain(xjson_shared_doc *d);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shared_release
+        描述:   减少共享json对象的引用计数，减为0时释放，可以并发调用
+
+        input:  d,              共享json对象，可以为NULL
+
+        output: None
+
+        return: None
+ *---------------------------------------------------------------------------*/
+void xjson_shared_release(xjson_shared_doc *d);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shared_root
+        描述:   获取共享json对象的根对象。根对象只读，const访问函数(包括
+                xjson_get_number、xjson_equal、xjson_hash)可以并发调用
+
+        input:  d,              共享json对象
+
+        output: None
+
+        return: success, 根对象
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+const xjson_value *xjson_shared_root(const xjson_shared_doc *d);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shared_slot_create
+        描述:   新建发布共享json对象的位置
+
+        input:  d,              初始的共享json对象，可以为NULL，其引用转移
+                                至slot
+
+        output: None
+
+        return: success, slot
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_shared_slot *xjson_shared_slot_create(xjson_shared_doc *d);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shared_slot_free
+        描述:   释放slot及其持有的引用，须在没有读者与写者时调用
+
+        input:  s,              slot
+
+        output: None
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_shared_slot_free(xjson_shared_slot *s);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shared_load
+        描述:   获取slot当前发布的共享json对象并增加引用计数，不加锁，
+                与xjson_shared_swap并发调用时返回新版本或旧版本
+
+        input:  s,              slot
+
+        output: None
+
+        return: success, 共享json对象，用完后须xjson_shared_release；
+                         slot为空时返回NULL
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_shared_doc *xjson_shared_load(xjson_shared_slot *s);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_shared_swap
+        描述:   发布新版本的共享json对象(RCU)。读者不被阻塞；写者之间
+                串行，并等待可能读到旧版本的读者完成引用后返回旧版本
+
+        input:  s,              slot
+                d,              新版本，可以为NULL，其引用转移至slot
+
+        output: None
+
+        return: success, 旧版本，由调用者xjson_shared_release；
+                         slot原为空时返回NULL
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_shared_doc *xjson_shared_swap(xjson_shared_slot *s, xjson_shared_doc *d);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_cache_create
+        描述:   创建解析结果缓存，超出任一上限时淘汰最久未使用的项。开启
+                XJSON_ENABLE_THREADS时可以并发使用
+
+        input:  max_entries,    最多缓存的项数，大于0
+                max_bytes,      输入副本与解析结果占用内存的上限，大于0
+
+        output: None
+
+        return: success, 缓存
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+xjson_cache *xjson_cache_create(size_t max_entries, size_t max_bytes);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_cache_parse
+        描述:   解析json并缓存结果。输入按内容hash查找，逐字节相同时直接
+                返回缓存的共享json对象，否则解析并缓存。解析失败的输入不
+                缓存，单项超过内存上限时不缓存
+
+        input:  c,              缓存
+                json,           json字符串，无需以'\0'结尾
+                len,            json字符串长度
+
+        output: c               更新后的缓存与统计
+
+        return: success, 共享json对象，调用者持有一个引用，须以
+                         xjson_shared_release释放
+                failure, 解析失败时返回NULL
+ *---------------------------------------------------------------------------*/
+xjson_shared_doc *xjson_cache_parse(xjson_cache *c, const char *json, size_t len);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_cache_get_stats
+        描述:   获取缓存的命中、未命中、淘汰次数与当前大小
+
+        input:  c,              缓存
+                stats,          统计
+
+        output: stats           统计的快照
+
+        return: success, None
+                failure, 程序终止
+ *---------------------------------------------------------------------------*/
+void xjson_cache_get_stats(xjson_cache *c, xjson_cache_stats *stats);
+
+/*---------------------------------------------------------------------------*
+        函数名: xjson_cache_free
+        描述:   释放缓存，调用者仍持有的共享json对象不受影响
+
+        input:  c,              缓存，可以为NULL
+
+        output: None
+
+        return: None
+ *---------------------------------------------------------------------------*/
+void xjson_cache_free(xjson_cache *c);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -0,0 +1,182 @@
+#ifndef XJSON_HPP_
+#define XJSON_HPP_
+
+#include <cstddef>                      // std::size_t
+#include <iterator>                     // std::random_access_iterator_tag
+#include <string_view>                  // std::string_view
+#include <type_traits>                  // std::is_arithmetic_v
+
+#include "xjson.h"
+
+/* xjson的C++17封装，只有头文件。全部成员函数均为内联的C接口调用，
+   不分配内存也不抛出异常，错误仍以XJSON_PARSE_*返回 */
+namespace xjson {
+
+using type = xjson_type;
+
+/*---------------------------------------------------------------------------*
+        类名:   value_ref
+        描述:   不持有所有权的json对象视图，生命周期不能超过所属的document
+
+        与C接口的对应:
+                get<bool>()             xjson_get_boolean
+                get<算术类型>()         xjson_get_number
+                get<std::string_view>() xjson_get_string，不复制
+                size()/operator[]       xjson_get_array_size/element
+ *---------------------------------------------------------------------------*/
+class value_ref {
+public:
+        class iterator;
+
+        value_ref() noexcept : v_(nullptr) {}
+        explicit value_ref(const xjson_value *v) noexcept : v_(v) {}
+
+        xjson::type type() const noexcept { return xjson_get_type(v_); }
+        bool is_null() const noexcept { return type() == XJSON_NULL; }
+        bool is_boolean() const noexcept { return type() == XJSON_TRUE || type() == XJSON_FALSE; }
+        bool is_number() const noexcept { return type() == XJSON_NUMBER; }
+        bool is_string() const noexcept { return type() == XJSON_STRING; }
+        bool is_array() const noexcept { return type() == XJSON_ARRAY; }
+
+        template <class T>
+        T get() const noexcept {
+                if constexpr (std::is_same_v<T, bool>) {
+                        return xjson_get_boolean(v_) != 0;
+                } else if constexpr (std::is_arithmetic_v<T>) {
+                        return static_cast<T>(xjson_get_number(v_));
+                } else if constexpr (std::is_same_v<T, std::string_view>) {
+                        return std::string_view(xjson_get_string(v_), xjson_get_string_length(v_));
+                } else {
+                        static_assert(std::is_same_v<T, value_ref>, "unsupported xjson::value_ref::get<T>()");
+                        return *this;
+                }
+        }
+
+        std::size_t size() const noexcept { return xjson_get_array_size(v_); }
+        value_ref operator[](std::size_t index) const noexcept {
+                return value_ref(xjson_get_array_element(v_, index));
+        }
+
+        /* array成员连续存放，遍历时只取一次首地址 */
+        iterator begin() const noexcept;
+        iterator end() const noexcept;
+
+        /* 按预编译路径访问，路径不存在时返回的视图为空 */
+        value_ref at(const xjson_accessor &acc) const noexcept { return value_ref(xjson_accessor_get(&acc, v_)); }
+        explicit operator bool() const noexcept { return v_ != nullptr; }
+
+        const xjson_value *c_ptr() const noexcept { return v_; }
+
+        friend bool operator==(value_ref a, value_ref b) noexcept { return xjson_equal(a.v_, b.v_) != 0; }
+        friend bool operator!=(value_ref a, value_ref b) noexcept { return !(a == b); }
+
+private:
+        const xjson_value *v_;
+};
+
+class value_ref::iterator {
+public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = value_ref;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_ref;
+
+        iterator() noexcept : p_(nullptr) {}
+        explicit iterator(const xjson_value *p) noexcept : p_(p) {}
+
+        value_ref operator*() const noexcept { return value_ref(p_); }
+        value_ref operator[](difference_type n) const noexcept { return value_ref(p_ + n); }
+        iterator &operator++() noexcept { ++p_; return *this; }
+        iterator operator++(int) noexcept { return iterator(p_++); }
+        iterator &operator--() noexcept { --p_; return *this; }
+        iterator operator--(int) noexcept { return iterator(p_--); }
+        iterator &operator+=(difference_type n) noexcept { p_ += n; return *this; }
+        iterator &operator-=(difference_type n) noexcept { p_ -= n; return *this; }
+        friend iterator operator+(iterator it, difference_type n) noexcept { return it += n; }
+        friend iterator operator-(iterator it, difference_type n) noexcept { return it -= n; }
+        friend difference_type operator-(iterator a, iterator b) noexcept { return a.p_ - b.p_; }
+        friend bool operator==(iterator a, iterator b) noexcept { return a.p_ == b.p_; }
+        friend bool operator!=(iterator a, iterator b) noexcept { return a.p_ != b.p_; }
+        friend bool operator<(iterator a, iterator b) noexcept { return a.p_ < b.p_; }
+
+private:
+        const xjson_value *p_;
+};
+
+inline value_ref::iterator value_ref::begin() const noexcept {
+        return iterator(size() > 0 ? xjson_get_array_element(v_, 0) : nullptr);
+}
+
+inline value_ref::iterator value_ref::end() const noexcept {
+        std::size_t n = size();
+        return iterator(n > 0 ? xjson_get_array_element(v_, 0) + n : nullptr);
+}
+
+/*---------------------------------------------------------------------------*
+        类名:   parser
+        描述:   持有xjson_parser，多次解析间复用会话栈。只能移动
+ *---------------------------------------------------------------------------*/
+class parser {
+public:
+        parser() noexcept { xjson_parser_init(&p_); }
+        ~parser() { xjson_parser_free(&p_); }
+
+        parser(const parser &) = delete;
+        parser &operator=(const parser &) = delete;
+        parser(parser &&o) noexcept : p_(o.p_) { xjson_parser_init(&o.p_); }
+        parser &operator=(parser &&o) noexcept {
+                if (this != &o) {
+                        xjson_parser_free(&p_);
+                        p_ = o.p_;
+                        xjson_parser_init(&o.p_);
+                }
+                return *this;
+        }
+
+        xjson_parser *c_ptr() noexcept { return &p_; }
+
+private:
+        xjson_parser p_;
+};
+
+/*---------------------------------------------------------------------------*
+        类名:   document
+        描述:   持有一个json对象，析构时释放。只能移动，移动不分配内存
+ *---------------------------------------------------------------------------*/
+class document {
+public:
+        document() noexcept { xjson_init(&v_); }
+        ~document() { xjson_free(&v_); }
+
+        document(const document &) = delete;
+        document &operator=(const document &) = delete;
+        document(document &&o) noexcept : v_(o.v_) { xjson_init(&o.v_); }
+        document &operator=(document &&o) noexcept {
+                xjson_move(&v_, &o.v_);
+                return *this;
+        }
+
+        /* json须以'\0'结尾，失败时为null */
+        int parse(const char *json) noexcept {
+                xjson_free(&v_);
+                return xjson_parse(&v_, json);
+        }
+
+        /* 开启XJSON_PARSER_LAZY_NUMBERS时，json须比document存活得久 */
+        int parse(parser &p, std::string_view json) noexcept {
+                xjson_free(&v_);
+                return xjson_parser_parse(p.c_ptr(), &v_, json.data(), json.size());
+        }
+
+        value_ref root() const noexcept { return value_ref(&v_); }
+        xjson_value *c_ptr() noexcept { return &v_; }
+        const xjson_value *c_ptr() const noexcept { return &v_; }
+
+private:
+        xjson_value v_;
+};
+
+}  // namespace xjson
+
+#endif